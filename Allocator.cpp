@@ -1,63 +1,210 @@
 #include "Allocator.h"
 #include "Utilities.h"
 #include <stdexcept>
+#include <algorithm>
 
 Allocator::Allocator(Core& core) {
     m_core = &core;
     m_properties = m_core->device().physicalDevice().memoryProperties();
 
     m_pages.resize(m_properties.memoryTypes.size());
+    m_freeLists.resize(m_properties.memoryTypes.size());
+    m_heapStats.resize(m_properties.memoryHeaps.size());
+    m_mutex = std::make_unique<std::mutex>();
+
+    for (size_t i = 0; i < m_heapStats.size(); i++) {
+        m_heapStats[i].size = m_properties.memoryHeaps[i].size;
+    }
 }
 
 Allocator::Allocator(Allocator&& other) {
     *this = std::move(other);
 }
 
-Page* Allocator::allocNewPage(uint32_t type, size_t size) {
-    size_t allocSize = 0;
-    while (allocSize < size) allocSize += PAGE_SIZE;
+HeapStats& Allocator::getHeapStats(uint32_t type) {
+    return m_heapStats[m_properties.memoryTypes[type].heapIndex];
+}
+
+void Allocator::addLive(uint32_t type, size_t size) {
+    auto& heap = getHeapStats(type);
+    heap.live += size;
+    heap.peak = std::max(heap.peak, heap.live);
+}
+
+size_t Allocator::getPageSize(uint32_t type) {
+    //small heaps, like the host visible part of VRAM, would be used up by a few full pages
+    size_t heapSize = getHeapStats(type).size;
+    size_t pageSize = PAGE_SIZE;
+    while (pageSize > DEDICATED_SIZE && pageSize * 8 > heapSize) pageSize /= 2;
+    return pageSize;
+}
+
+bool Allocator::withinBudget(uint32_t type, size_t size) {
+    uint32_t heapIndex = m_properties.memoryTypes[type].heapIndex;
+    auto& heap = m_heapStats[heapIndex];
+
+    if (m_core->memoryBudget()) {
+        //the driver's numbers include other processes and memory allocated outside this class
+        std::vector<size_t> budget;
+        std::vector<size_t> usage;
+        m_core->getMemoryBudget(budget, usage);
+
+        heap.budget = budget[heapIndex];
+        return usage[heapIndex] + size <= budget[heapIndex];
+    }
+
+    heap.budget = heap.size;
+    return heap.allocated + size <= heap.size;
+}
+
+std::unique_ptr<vk::DeviceMemory> Allocator::allocMemory(uint32_t type, size_t size) {
+    if (!withinBudget(type, size)) return nullptr;
+
     vk::MemoryAllocateInfo info = {};
     info.memoryTypeIndex = type;
-    info.allocationSize = allocSize;
+    info.allocationSize = size;
 
-    try {
-        m_pages[type].emplace_back(Page{ std::make_unique<vk::DeviceMemory>(m_core->device(), info), allocSize, size });
-        auto& newPage = m_pages[type].back();
+    std::unique_ptr<vk::DeviceMemory> memory;
 
-        if ((m_properties.memoryTypes[type].propertyFlags & vk::MemoryPropertyFlags::HostVisible) != vk::MemoryPropertyFlags::None) {
-            void* mapping = newPage.memory->map(0, allocSize);
-            m_mappings.insert({ newPage.memory.get(), mapping });
-        }
-
-        return &newPage;
+    try {
+        memory = std::make_unique<vk::DeviceMemory>(m_core->device(), info);
     }
     catch (...) {
         return nullptr;
     }
+
+    if ((m_properties.memoryTypes[type].propertyFlags & vk::MemoryPropertyFlags::HostVisible) != vk::MemoryPropertyFlags::None) {
+        void* mapping = memory->map(0, size);
+        m_mappings.insert({ memory.get(), mapping });
+    }
+
+    getHeapStats(type).allocated += size;
+
+    return memory;
 }
 
-Allocation Allocator::tryAlloc(uint32_t type, vk::MemoryRequirements requirements) {
+Page* Allocator::allocNewPage(uint32_t type, size_t size) {
+    size_t pageSize = getPageSize(type);
+    size_t allocSize = align(size, pageSize);
+
+    auto memory = allocMemory(type, allocSize);
+    if (memory == nullptr) return nullptr;
+
+    auto page = std::make_unique<Page>();
+    page->memory = std::move(memory);
+    page->size = allocSize;
+    page->live = 0;
+
+    Page* result = page.get();
+    m_pageLookup.insert({ result->memory.get(), result });
+    m_pages[type].push_back(std::move(page));
+
+    addFreeRange(type, result, 0, allocSize);
+
+    return result;
+}
+
+void Allocator::freePage(uint32_t type, Page* page) {
+    for (auto& range : page->freeRanges) {
+        auto bucket = m_freeLists[type].equal_range(range.second);
+        for (auto it = bucket.first; it != bucket.second; it++) {
+            if (it->second.page == page && it->second.offset == range.first) {
+                m_freeLists[type].erase(it);
+                break;
+            }
+        }
+    }
+
+    getHeapStats(type).allocated -= page->size;
+    m_mappings.erase(page->memory.get());
+    m_pageLookup.erase(page->memory.get());
+
     auto& pages = m_pages[type];
+    pages.erase(std::find_if(pages.begin(), pages.end(), [page](auto& p) { return p.get() == page; }));
+}
 
-    if (pages.size() > 0) {
-        auto& page = pages.back();
+void Allocator::addFreeRange(uint32_t type, Page* page, size_t offset, size_t size) {
+    page->freeRanges.insert({ offset, size });
+    m_freeLists[type].insert({ size, { page, offset } });
+}
+
+void Allocator::removeFreeRange(uint32_t type, Page* page, size_t offset, size_t size) {
+    page->freeRanges.erase(offset);
 
-        size_t aligned = align(page.ptr, requirements.alignment);
-        if (aligned + requirements.size <= page.size) {
-            page.ptr = aligned + requirements.size;
-            return { page.memory.get(), requirements.size, aligned };
+    auto bucket = m_freeLists[type].equal_range(size);
+    for (auto it = bucket.first; it != bucket.second; it++) {
+        if (it->second.page == page && it->second.offset == offset) {
+            m_freeLists[type].erase(it);
+            return;
         }
     }
+}
+
+Allocation Allocator::allocDedicated(uint32_t type, vk::MemoryRequirements requirements) {
+    auto memory = allocMemory(type, requirements.size);
+    if (memory == nullptr) return {};
+
+    vk::DeviceMemory* result = memory.get();
+    m_dedicated.insert({ result, std::move(memory) });
+    addLive(type, requirements.size);
 
-    auto newPage = allocNewPage(type, requirements.size);
-    if (newPage != nullptr) {
-        return { newPage->memory.get(), requirements.size, 0 };
+    return { result, requirements.size, 0, type, true };
+}
+
+Allocation Allocator::tryAlloc(uint32_t type, vk::MemoryRequirements requirements) {
+    if (requirements.size >= DEDICATED_SIZE) {
+        return allocDedicated(type, requirements);
+    }
+
+    auto& freeList = m_freeLists[type];
+    Page* page = nullptr;
+    size_t rangeOffset = 0;
+    size_t rangeSize = 0;
+    size_t aligned = 0;
+
+    //best fit, the first range that still fits after alignment
+    for (auto it = freeList.lower_bound(requirements.size); it != freeList.end(); it++) {
+        size_t candidate = align(it->second.offset, requirements.alignment);
+        if (candidate + requirements.size <= it->second.offset + it->first) {
+            page = it->second.page;
+            rangeOffset = it->second.offset;
+            rangeSize = it->first;
+            aligned = candidate;
+            break;
+        }
+    }
+
+    if (page == nullptr) {
+        page = allocNewPage(type, requirements.size);
+        if (page == nullptr) return {};
+
+        rangeOffset = 0;
+        rangeSize = page->size;
+        aligned = 0;
+    }
+
+    //the alignment gap and the remainder stay free, and merge back once their neighbors are freed
+    removeFreeRange(type, page, rangeOffset, rangeSize);
+
+    if (aligned > rangeOffset) {
+        addFreeRange(type, page, rangeOffset, aligned - rangeOffset);
+    }
+
+    size_t end = aligned + requirements.size;
+    size_t rangeEnd = rangeOffset + rangeSize;
+    if (end < rangeEnd) {
+        addFreeRange(type, page, end, rangeEnd - end);
     }
 
-    return {};
+    page->live += requirements.size;
+    addLive(type, requirements.size);
+
+    return { page->memory.get(), requirements.size, aligned, type, false };
 }
 
 Allocation Allocator::allocate(vk::MemoryRequirements requirements, vk::MemoryPropertyFlags preferred, vk::MemoryPropertyFlags required) {
+    std::lock_guard<std::mutex> lock(*m_mutex);
+
     for (uint32_t i = 0; i < m_properties.memoryTypes.size(); i++) {
         if (((requirements.memoryTypeBits >> i) & 1) != 0
             && (m_properties.memoryTypes[i].propertyFlags & preferred) == preferred) {
@@ -81,7 +228,62 @@ Allocation Allocator::allocate(vk::MemoryRequirements requirements, vk::MemoryPr
     throw std::runtime_error("Failed to allocate memory");
 }
 
+void Allocator::free(const Allocation& allocation) {
+    if (allocation.memory == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(*m_mutex);
+
+    //memory that is already gone was freed before, so there is nothing to give back
+    if (allocation.dedicated) {
+        if (m_dedicated.count(allocation.memory) == 0) return;
+
+        getHeapStats(allocation.type).live -= allocation.size;
+        getHeapStats(allocation.type).allocated -= allocation.size;
+        m_mappings.erase(allocation.memory);
+        m_dedicated.erase(allocation.memory);
+        return;
+    }
+
+    auto it = m_pageLookup.find(allocation.memory);
+    if (it == m_pageLookup.end()) return;
+
+    getHeapStats(allocation.type).live -= allocation.size;
+    Page* page = it->second;
+    size_t offset = allocation.offset;
+    size_t size = allocation.size;
+
+    //merge with the free ranges on either side
+    auto next = page->freeRanges.lower_bound(offset);
+    if (next != page->freeRanges.end() && next->first == offset + size) {
+        size_t nextSize = next->second;
+        removeFreeRange(allocation.type, page, next->first, nextSize);
+        size += nextSize;
+    }
+
+    auto prev = page->freeRanges.lower_bound(offset);
+    if (prev != page->freeRanges.begin()) {
+        prev--;
+        if (prev->first + prev->second == offset) {
+            size_t prevOffset = prev->first;
+            size_t prevSize = prev->second;
+            removeFreeRange(allocation.type, page, prevOffset, prevSize);
+            offset = prevOffset;
+            size += prevSize;
+        }
+    }
+
+    addFreeRange(allocation.type, page, offset, size);
+    page->live -= allocation.size;
+
+    //keep one page per type around, so a buffer that is freed and recreated does not allocate device memory each time
+    if (page->live == 0 && m_pages[allocation.type].size() > 1) {
+        freePage(allocation.type, page);
+    }
+}
+
 void* Allocator::getMapping(vk::DeviceMemory* memory, size_t offset) {
+    std::lock_guard<std::mutex> lock(*m_mutex);
+
     auto it = m_mappings.find(memory);
     if (it != m_mappings.end()) {
         void* result = it->second;
@@ -90,4 +292,26 @@ void* Allocator::getMapping(vk::DeviceMemory* memory, size_t offset) {
     } else {
         return nullptr;
     }
-}
\ No newline at end of file
+}
+
+std::vector<HeapStats> Allocator::stats() {
+    std::vector<size_t> budget;
+    std::vector<size_t> usage;
+
+    if (m_core->memoryBudget()) {
+        m_core->getMemoryBudget(budget, usage);
+    }
+
+    std::unique_lock<std::mutex> lock(*m_mutex);
+    std::vector<HeapStats> result = m_heapStats;
+    lock.unlock();
+
+    for (size_t i = 0; i < result.size(); i++) {
+        auto& heap = result[i];
+        heap.budget = budget.empty() ? heap.size : budget[i];
+        //free space in pages and alignment gaps
+        heap.wasted = heap.allocated - heap.live;
+    }
+
+    return result;
+}
@@ -1,21 +1,43 @@
 #pragma once
+#include <map>
+#include <unordered_map>
+#include <mutex>
 #include "Core.h"
 
 #define PAGE_SIZE (128 * 1024 * 1024)
+//allocations at least this large get their own device memory instead of a piece of a page
+#define DEDICATED_SIZE (32 * 1024 * 1024)
 
 struct Allocation {
     vk::DeviceMemory* memory;
     size_t size;
     size_t offset;
+    uint32_t type;
+    bool dedicated;
 };
 
 struct Page {
     std::unique_ptr<vk::DeviceMemory> memory;
     size_t size;
-    size_t ptr;
+    size_t live;
+    std::map<size_t, size_t> freeRanges;
+};
+
+struct HeapStats {
+    size_t size;
+    size_t budget;
+    size_t allocated;
+    size_t live;
+    size_t peak;
+    size_t wasted;
 };
 
 class Allocator {
+    struct FreeRange {
+        Page* page;
+        size_t offset;
+    };
+
 public:
     Allocator(Core& core);
     Allocator(const Allocator& other) = delete;
@@ -24,14 +46,33 @@ public:
     Allocator& operator = (Allocator&& other) = default;
 
     Allocation allocate(vk::MemoryRequirements requirements, vk::MemoryPropertyFlags preferred, vk::MemoryPropertyFlags required);
+    void free(const Allocation& allocation);
     void* getMapping(vk::DeviceMemory* memory, size_t offset);
 
+    std::vector<HeapStats> stats();
+
 private:
     Core* m_core;
     vk::MemoryProperties m_properties;
-    std::vector<std::vector<Page>> m_pages;
+    std::vector<std::vector<std::unique_ptr<Page>>> m_pages;
+    //free ranges of every page of a memory type, by size, so the smallest range that fits is found first
+    std::vector<std::multimap<size_t, FreeRange>> m_freeLists;
+    std::unordered_map<vk::DeviceMemory*, Page*> m_pageLookup;
+    std::unordered_map<vk::DeviceMemory*, std::unique_ptr<vk::DeviceMemory>> m_dedicated;
     std::unordered_map<vk::DeviceMemory*, void*> m_mappings;
+    std::vector<HeapStats> m_heapStats;
+    //generators running side by side allocate from their own threads
+    std::unique_ptr<std::mutex> m_mutex;
 
     Allocation tryAlloc(uint32_t type, vk::MemoryRequirements requirements);
+    Allocation allocDedicated(uint32_t type, vk::MemoryRequirements requirements);
     Page* allocNewPage(uint32_t type, size_t size);
-};
\ No newline at end of file
+    std::unique_ptr<vk::DeviceMemory> allocMemory(uint32_t type, size_t size);
+    void freePage(uint32_t type, Page* page);
+    bool withinBudget(uint32_t type, size_t size);
+    size_t getPageSize(uint32_t type);
+    void addFreeRange(uint32_t type, Page* page, size_t offset, size_t size);
+    void removeFreeRange(uint32_t type, Page* page, size_t offset, size_t size);
+    HeapStats& getHeapStats(uint32_t type);
+    void addLive(uint32_t type, size_t size);
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <vector>
+#include "MemoryTracker.h"
 
 struct Color32 {
     uint8_t r;
@@ -27,5 +28,5 @@ public:
 private:
     size_t m_width;
     size_t m_height;
-    std::vector<Color32> m_data;
+    std::vector<Color32, TrackingAllocator<Color32, MemoryCategory::Bitmap>> m_data;
 };
\ No newline at end of file
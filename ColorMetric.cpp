@@ -0,0 +1,92 @@
+#include "ColorMetric.h"
+#include <cmath>
+#include <algorithm>
+
+//Lab is scaled by 0.6, so one stored step is 1/0.6 or about 1.67 units of Lab distance, and offset so every
+//channel of an sRGB color stays within 0 to 127, which reads back the same from the signed and unsigned image formats.
+//b spans about 203 units, so 0.6 is close to the finest scale that still fits
+#define LAB_SCALE 0.6f
+#define LAB_A_OFFSET 87.0f
+#define LAB_B_OFFSET 108.0f
+
+//D65 white point
+#define WHITE_X 0.95047f
+#define WHITE_Y 1.0f
+#define WHITE_Z 1.08883f
+
+float labCurve(float t) {
+    const float delta = 6.0f / 29.0f;
+    if (t > delta * delta * delta) return std::cbrt(t);
+    return t / (3.0f * delta * delta) + 4.0f / 29.0f;
+}
+
+uint8_t quantize(float value) {
+    return static_cast<uint8_t>(std::min(std::max(std::lround(value * LAB_SCALE), 0l), 127l));
+}
+
+ColorMetric::ColorMetric(Metric metric) {
+    m_metric = metric;
+
+    for (size_t i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        m_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+Color32 ColorMetric::getKey(Color32 color) const {
+    if (m_metric == Metric::Lab) return toLab(color);
+    return color;
+}
+
+Color32 ColorMetric::toLab(Color32 color) const {
+    float r = m_linear[color.r];
+    float g = m_linear[color.g];
+    float b = m_linear[color.b];
+
+    float x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / WHITE_X;
+    float y = (0.2126729f * r + 0.7151522f * g + 0.0721750f * b) / WHITE_Y;
+    float z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / WHITE_Z;
+
+    float fx = labCurve(x);
+    float fy = labCurve(y);
+    float fz = labCurve(z);
+
+    float l = 116.0f * fy - 16.0f;
+    float a = 500.0f * (fx - fy);
+    float bb = 200.0f * (fy - fz);
+
+    return { quantize(l), quantize(a + LAB_A_OFFSET), quantize(bb + LAB_B_OFFSET), color.a };
+}
+
+double ColorMetric::neighborDistance(Bitmap& bitmap) {
+    double sum = 0.0;
+    size_t count = 0;
+
+    //each pair is counted once, through the right and lower neighbors
+    const int32_t offsets[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+    for (size_t y = 0; y < bitmap.height(); y++) {
+        for (size_t x = 0; x < bitmap.width(); x++) {
+            Color32 color = bitmap.getPixel(x, y);
+            if (color.a == 0) continue;
+
+            for (size_t i = 0; i < 4; i++) {
+                int64_t nx = static_cast<int64_t>(x) + offsets[i][0];
+                int64_t ny = static_cast<int64_t>(y) + offsets[i][1];
+                if (nx < 0 || nx >= static_cast<int64_t>(bitmap.width()) || ny >= static_cast<int64_t>(bitmap.height())) continue;
+
+                Color32 other = bitmap.getPixel(static_cast<size_t>(nx), static_cast<size_t>(ny));
+                if (other.a == 0) continue;
+
+                int32_t r = color.r - other.r;
+                int32_t g = color.g - other.g;
+                int32_t b = color.b - other.b;
+                sum += std::sqrt(static_cast<double>(r * r + g * g + b * b));
+                count++;
+            }
+        }
+    }
+
+    if (count == 0) return 0.0;
+    return sum / count;
+}
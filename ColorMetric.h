@@ -0,0 +1,21 @@
+#pragma once
+#include "Bitmap.h"
+#include "Options.h"
+
+//converts colors to the form the generators score, so every metric is a squared distance of 8 bit channels
+class ColorMetric {
+public:
+    ColorMetric(Metric metric);
+
+    Metric type() const { return m_metric; }
+    Color32 getKey(Color32 color) const;
+
+    //average distance between neighboring placed pixels of a bitmap of display colors, lower is smoother
+    static double neighborDistance(Bitmap& bitmap);
+
+private:
+    Metric m_metric;
+    float m_linear[256];
+
+    Color32 toLab(Color32 color) const;
+};
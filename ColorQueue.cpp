@@ -12,11 +12,29 @@ ColorQueue::ColorQueue(ColorQueue&& other) {
 }
 
 void ColorQueue::enqueue(glm::ivec2 pos, Color32 color) {
+    bool wasEmpty;
+
+    if (m_listener) {
+        m_listener(pos, color);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(*m_mutex);
+        wasEmpty = m_front->empty();
+        m_front->push_back({ pos, color });
+    }
+
+    if (wasEmpty && m_notify) {
+        m_notify();
+    }
+}
+
+bool ColorQueue::empty() {
     std::lock_guard<std::mutex> lock(*m_mutex);
-    m_front->push_back({ pos, color });
+    return m_front->empty();
 }
 
-const std::vector<ColorQueue::Item>& ColorQueue::swap() {
+const ColorQueue::ItemList& ColorQueue::swap() {
     std::lock_guard<std::mutex> lock(*m_mutex);
     std::swap(m_front, m_back);
     m_totalCount += m_front->size();
@@ -1,8 +1,10 @@
 #pragma once
 #include <mutex>
 #include <vector>
+#include <functional>
 #include <glm/glm.hpp>
 #include "Bitmap.h"
+#include "MemoryTracker.h"
 
 class ColorQueue {
     struct Item {
@@ -10,6 +12,8 @@ class ColorQueue {
         Color32 color;
     };
 
+    using ItemList = std::vector<Item, TrackingAllocator<Item, MemoryCategory::ColorQueue>>;
+
 public:
     ColorQueue();
     ColorQueue(const ColorQueue& other) = delete;
@@ -18,13 +22,20 @@ public:
     ColorQueue& operator = (ColorQueue&& other) = default;
 
     void enqueue(glm::ivec2 pos, Color32 color);
-    const std::vector<Item>& swap();
+    const ItemList& swap();
+    bool empty();
     size_t totalCount() const { return m_totalCount; }
+    //called from the enqueueing thread when the first item lands after a swap
+    void setNotify(std::function<void()> notify) { m_notify = std::move(notify); }
+    //called from the enqueueing thread for every item, before it is queued
+    void setListener(std::function<void(glm::ivec2, Color32)> listener) { m_listener = std::move(listener); }
 
 private:
     std::unique_ptr<std::mutex> m_mutex;
-    std::vector<Item> m_buffers[2];
-    std::vector<Item>* m_front;
-    std::vector<Item>* m_back;
+    ItemList m_buffers[2];
+    ItemList* m_front;
+    ItemList* m_back;
     size_t m_totalCount;
+    std::function<void()> m_notify;
+    std::function<void(glm::ivec2, Color32)> m_listener;
 };
\ No newline at end of file
@@ -1,6 +1,24 @@
 #include "ColorSource.h"
+#include <math.h>
 
 uint8_t ColorSource::map(uint32_t num, uint32_t bitDepth) {
     num = (num + 1) << (8 - bitDepth);
     return static_cast<uint8_t>(num - 1);
-}
\ No newline at end of file
+}
+
+Palette ColorSource::createColors(int32_t bitDepth) {
+    auto palette = std::make_shared<PaletteColors>();
+    auto& colors = *palette;
+
+    uint32_t max = static_cast<uint32_t>(pow(2, bitDepth));
+    for (uint32_t r = 0; r < max; r++) {
+        for (uint32_t g = 0; g < max; g++) {
+            for (uint32_t b = 0; b < max; b++) {
+                Color32 color = { map(r, bitDepth), map(g, bitDepth), map(b, bitDepth), 255 };
+                colors.push_back(color);
+            }
+        }
+    }
+
+    return palette;
+}
@@ -1,11 +1,21 @@
 #pragma once
+#include <memory>
+#include <vector>
 #include "Bitmap.h"
+#include "MemoryTracker.h"
+
+using PaletteColors = std::vector<Color32, TrackingAllocator<Color32, MemoryCategory::Palette>>;
+//every color a source hands out, in order, shared by every source built from the same settings
+using Palette = std::shared_ptr<const PaletteColors>;
 
 class ColorSource {
 public:
     virtual bool hasNext() = 0;
     virtual Color32 getNext() = 0;
     virtual void resubmit(Color32 color) = 0;
+    virtual ~ColorSource() {}
 
     static uint8_t map(uint32_t num, uint32_t bitDepth);
+    //every color of a bit depth in channel order, before a source puts them in its own order
+    static Palette createColors(int32_t bitDepth);
 };
@@ -4,108 +4,230 @@
 #include <cmath>
 #include <chrono>
 #include <iomanip>
+#include <limits>
+#include <cstddef>
+
+#define BATCH_GROWTH_LIMIT 4
+#define BATCH_WINDOW 0.25
+#define CANDIDATES 4
+//the main pass loops over the frontier, so its output does not grow with the image
+#define MAX_MAIN_WORK_GROUPS 256
+#define UMAX std::numeric_limits<uint32_t>::max()
+
+#define FRONTIER_ARGS 0
+#define FRONTIER_GATHER 1
+#define FRONTIER_COPY 2
+
+//must match the shaders
+#define TILE_SIZE 8
+
+const uint32_t PREWARM_WORK_GROUP_SIZES[] = { 32, 64 };
+
+#define STAGE_UPDATE 0
+#define STAGE_FRONTIER 1
+#define STAGE_BOUNDS 2
+#define STAGE_MAIN 3
+#define STAGE_REDUCE 4
+#define STAGE_ASSIGN 5
+#define STAGE_COPY 6
+
+struct FrontierInfo {
+    uint32_t count;
+    uint32_t scratchCount;
+    uint32_t tileCount;
+    uint32_t tileScratchCount;
+    glm::uvec4 mainDispatch;
+    glm::uvec4 compactDispatch;
+};
 
-#define FRAMES 2
+struct NeighborSums {
+    int32_t count;
+    int32_t r;
+    int32_t g;
+    int32_t b;
+    int32_t squares;
+};
+
+struct Tile {
+    int32_t open;
+    uint32_t listed;
+    uint32_t padding[2];
+    uint32_t low[4];
+    uint32_t high[4];
+};
 
 ComputeGenerator::ComputeGenerator(Core& core, Allocator& allocator, ColorSource& source, ColorQueue& colorQueue, Options& options)
-    : m_bitmap(options.size.x, options.size.y) {
+    : m_bitmap(options.size.x, options.size.y), m_metric(options.metric) {
     m_core = &core;
     m_allocator = &allocator;
     m_source = &source;
     m_size = options.size;
     m_colorQueue = &colorQueue;
-    m_frameData.resize(FRAMES);
+    m_frames = options.framesInFlight;
+    m_frameData.resize(m_frames);
 
     m_running = std::make_unique<std::atomic_bool>();
+    m_finished = std::make_unique<std::atomic_bool>(false);
+    m_completed = std::make_unique<std::atomic<uint64_t>>(0);
+    m_collisionRate = std::make_unique<std::atomic<float>>(0.0f);
 
     m_workGroupSize = options.workGroupSize;
+    m_radius = static_cast<int32_t>(options.radius);
     m_maxBatchAbsolute = options.maxBatchAbsolute;
     m_maxBatchRelative = options.maxBatchRelative;
+    m_adaptiveBatch = options.adaptiveBatch;
+    m_collisionCeiling = options.collisionCeiling;
+    m_batchCapacity = m_maxBatchAbsolute;
+    m_batchLimit = m_maxBatchAbsolute;
+    m_maxBatchLimit = m_adaptiveBatch ? m_maxBatchAbsolute * BATCH_GROWTH_LIMIT : m_maxBatchAbsolute;
+    //every frame in flight can place a full batch before the submit thread drains them
+    m_updateCapacity = m_frames * m_batchCapacity + 1;
+
+    m_freeSlots = std::make_unique<LockFreeQueue<uint32_t>>(m_frames);
+    m_submittedSlots = std::make_unique<LockFreeQueue<uint32_t>>(m_frames + 1);
+    m_submittedMutex = std::make_unique<std::mutex>();
+    m_submittedReady = std::make_unique<std::condition_variable>();
+    m_placements = std::make_unique<LockFreeQueue<Placement>>(m_updateCapacity);
+    m_rejected = std::make_unique<LockFreeQueue<Color32>>(m_updateCapacity);
+
+    for (uint32_t i = 0; i < m_frames; i++) {
+        m_freeSlots->push(i);
+    }
 
     createCommandPool();
     createCommandBuffers();
     createTexture();
     createTextureView();
-    createPositionBuffers();
+    createKeyTexture();
+    createFrontierBuffers();
     createColorBuffers();
     createOutputBuffers();
+    createUpdateBuffers();
     createDescriptorSetLayout();
     createDescriptorPool();
     createDescriptorSets();
     writeDescriptors();
     createUpdatePipelineLayout();
     createUpdatePipeline();
+    createFrontierPipelineLayout();
+    createFrontierPipeline();
     createMainPipelineLayout();
     createMainPipeline(options.shader);
+    createBoundsPipeline();
+    createReducePipeline();
+    createAssignPipelineLayout();
+    createAssignPipeline();
     createFences();
 
+    if (options.prewarmCache) {
+        prewarmPipelines();
+    }
+
+    m_profiler = std::make_unique<Profiler>(*m_core, m_core->computeQueueFamilyIndex(), m_frames,
+        std::vector<std::string>{ "update", "frontier", "bounds", "main", "reduce", "assign", "copy" });
+
     glm::ivec2 pos = m_size / 2;
     if (m_source->hasNext()) {
         Color32 color = m_source->getNext();
-        m_queue.push({ color, pos });
         m_colorQueue->enqueue(pos, color);
+        m_bitmap.getPixel(pos.x, pos.y) = color;
         addNeighborsToOpenSet(pos);
+        m_placements->push({ color, pos, m_openedCount, static_cast<uint32_t>(m_openSet.size()) });
     }
 }
 
-ComputeGenerator::ComputeGenerator(ComputeGenerator&& other) : m_bitmap(std::move(other.m_bitmap)) {
+ComputeGenerator::ComputeGenerator(ComputeGenerator&& other) : m_bitmap(std::move(other.m_bitmap)), m_metric(other.m_metric) {
     *this = std::move(other);
 }
 
+ComputeGenerator::~ComputeGenerator() {
+    //the allocator outlives generators, so memory goes back to it for the next job
+    for (auto& alloc : m_allocations) {
+        m_allocator->free(alloc);
+    }
+
+    for (auto& frameData : m_frameData) {
+        for (auto& alloc : frameData.allocations) {
+            m_allocator->free(alloc);
+        }
+    }
+}
+
 void ComputeGenerator::run() {
     *m_running = true;
-    m_thread = std::thread([this]() -> void { generatorLoop(); });
+    m_start = std::chrono::steady_clock::now();
+    m_thread = std::thread([this]() -> void { submitLoop(); });
+    m_readbackThread = std::thread([this]() -> void { readbackLoop(); });
 }
 
 void ComputeGenerator::stop() {
     *m_running = false;
     m_thread.join();
+    m_readbackThread.join();
 }
 
-void ComputeGenerator::generatorLoop() {
+void ComputeGenerator::submitLoop() {
     std::this_thread::sleep_for(std::chrono::milliseconds(33));
-    std::vector<std::vector<glm::ivec2>> openLists(FRAMES);
-    std::vector<std::vector<Color32>> colors(FRAMES);
-    auto start = std::chrono::steady_clock::now();
 
-    while (*m_running) {
-        size_t index = m_frame % FRAMES;
+    //speculation depth, lowered when the batches in flight keep choosing the same pixels
+    uint32_t activeFrames = m_frames;
+    uint64_t nextTune = m_frames;
 
-        auto& openList = openLists[index];
-        auto& colorList = colors[index];
-        auto& frameData = m_frameData[index];
+    while (*m_running) {
+        //read before draining, so a slot seen as complete has its results in the queues
+        uint64_t inFlight = m_submitted - m_completed->load(std::memory_order_acquire);
+        drainQueues();
+
+        bool colorsLeft = m_retry.size() > 0 || m_source->hasNext();
+        if (!colorsLeft || m_appliedOpen == 0) {
+            if (inFlight == 0) break;
+            std::this_thread::yield();
+            continue;
+        }
 
-        if (m_openSet.size() == 0) break;
-        if (!m_source->hasNext()) break;
+        uint32_t batchSize = getBatchSize();
+        if (batchSize > m_batchCapacity) {
+            //buffers can only be replaced while no batch uses them
+            if (inFlight > 0) {
+                std::this_thread::yield();
+                continue;
+            }
 
-        m_fences[index].wait();
-        m_fences[index].reset();
+            resizeBatchBuffers(std::min(m_maxBatchLimit, std::max(batchSize, m_batchCapacity * 2)));
+        }
 
-        if (m_frame >= FRAMES) {
-            readResult(index, openList, colorList);
-            colorList.clear();
+        uint32_t index;
+        if (inFlight >= activeFrames || !m_freeSlots->pop(index)) {
+            std::this_thread::yield();
+            continue;
         }
 
-        openList.clear();
+        auto prepStart = std::chrono::steady_clock::now();
+        auto& frameData = m_frameData[index];
 
-        for (auto& pos : m_openSet) {
-            openList.push_back(pos);
+        if (frameData.complete) {
+            frameData.complete = false;
+            if (m_adaptiveBatch) updateBatchLimit(frameData);
         }
 
-        memcpy(frameData.positionMapping, openList.data(), openList.size() * sizeof(glm::ivec2));
-
-        uint32_t batchSize = std::max<uint32_t>(1, std::min<uint32_t>(m_maxBatchAbsolute, static_cast<uint32_t>(openList.size() / m_maxBatchRelative)));
         glm::ivec4* colorPtr = static_cast<glm::ivec4*>(frameData.colorMapping);
 
         for (uint32_t i = 0; i < batchSize; i++) {
-            if (m_source->hasNext()) {
-                Color32 color = m_source->getNext();
-                colorList.push_back(color);
-                colorPtr[i] = glm::ivec4(color.r, color.g, color.b, 255);
+            Color32 color;
+
+            if (m_retry.size() > 0) {
+                color = m_retry.back();
+                m_retry.pop_back();
+            } else if (m_source->hasNext()) {
+                color = m_source->getNext();
             } else {
                 batchSize = i;
                 break;
             }
+
+            frameData.colors.push_back(color);
+            Color32 key = m_metric.getKey(color);
+            colorPtr[i] = glm::ivec4(key.r, key.g, key.b, 255);
         }
 
         vk::CommandBuffer& commandBuffer = *frameData.commandBuffer;
@@ -116,56 +238,256 @@ void ComputeGenerator::generatorLoop() {
 
         commandBuffer.begin(beginInfo);
 
-        record(commandBuffer, openList, colorList, index, batchSize);
+        record(commandBuffer, index, batchSize);
 
         commandBuffer.end();
 
-        m_core->submitCompute(commandBuffer, &m_fences[index]);
+        //with timeline semaphores the readback thread waits on the batch's value instead of a fence
+        vk::Fence* fence = m_core->timelineSemaphores() ? nullptr : &m_fences[index];
+        frameData.computeValue = m_core->submitCompute(commandBuffer, fence);
+        frameData.submitTime = std::chrono::steady_clock::now();
+        frameData.cpuTime = std::chrono::duration<double>(frameData.submitTime - prepStart).count();
+
+        pushSubmitted(index);
+        m_submitted++;
 
-        m_frame++;
+        if (m_submitted >= nextTune) {
+            float collisionRate = m_collisionRate->load(std::memory_order_relaxed);
+
+            if (collisionRate > m_collisionCeiling && activeFrames > 1) {
+                activeFrames--;
+            } else if (collisionRate < m_collisionCeiling / 2 && activeFrames < m_frames) {
+                activeFrames++;
+            }
+
+            nextTune = m_submitted + m_frames;
+        }
     }
 
-    for (size_t i = 0; i < FRAMES; i++) {
-        m_frame++;
-        size_t index = m_frame % FRAMES;
+    pushSubmitted(UMAX);
+}
 
-        auto& openList = openLists[index];
-        auto& color = colors[index];
+void ComputeGenerator::pushSubmitted(uint32_t index) {
+    while (!m_submittedSlots->push(index)) {
+        std::this_thread::yield();
+    }
+
+    //taking the lock orders the push before a readback thread that is about to wait
+    {
+        std::lock_guard<std::mutex> lock(*m_submittedMutex);
+    }
 
-        m_fences[index].wait();
-        m_fences[index].reset();
+    m_submittedReady->notify_one();
+}
 
-        if (m_frame >= FRAMES) {
-            readResult(index, openList, color);
+void ComputeGenerator::readbackLoop() {
+    while (true) {
+        uint32_t index;
+        if (!m_submittedSlots->pop(index)) {
+            std::unique_lock<std::mutex> lock(*m_submittedMutex);
+            m_submittedReady->wait(lock, [&] { return m_submittedSlots->pop(index); });
         }
+
+        if (index == UMAX) break;
+
+        uint64_t computeValue = m_frameData[index].computeValue;
+        if (computeValue > 0) {
+            m_core->waitCompute(computeValue);
+        } else {
+            m_fences[index].wait();
+            m_fences[index].reset();
+        }
+
+        auto& frameData = m_frameData[index];
+        //submit to readback, which includes queueing behind other batches and the wait itself
+        frameData.latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameData.submitTime).count();
+        frameData.gpuTime = m_profiler->collect(index) / 1000.0;
+        readResult(index);
+        frameData.complete = true;
+
+        m_freeSlots->push(index);
+        m_completed->fetch_add(1, std::memory_order_release);
     }
 
     auto end = std::chrono::steady_clock::now();
 
     std::this_thread::sleep_for(std::chrono::milliseconds(33));
 
-    auto elapsed = std::chrono::duration<double>(end - start).count();
+    auto elapsed = std::chrono::duration<double>(end - m_start).count();
     size_t totalPixels = m_colorQueue->totalCount();
     size_t rate = (size_t)(totalPixels / elapsed);
+
+    std::lock_guard<std::mutex> lock(outputMutex());
     if (elapsed < 10.0) {
         std::cout << std::setprecision(1) << std::fixed;
     } else {
         std::cout << std::setprecision(0) << std::fixed;
     }
     std::cout << totalPixels << " in " << elapsed << "s (" << rate << " pps)\n";
+
+    if (m_dispatchedCount > 0) {
+        double placementRate = 100.0 * m_placedCount / m_dispatchedCount;
+        std::cout << std::setprecision(1) << std::fixed;
+        std::cout << "Placement rate: " << placementRate << "% (" << m_placedCount << " of " << m_dispatchedCount << " colors)\n";
+    }
+
+    *m_finished = true;
 }
 
-struct UpdatePushConstants {
+uint32_t ComputeGenerator::getBatchSize() {
+    if (!m_adaptiveBatch) {
+        return std::max<uint32_t>(1, std::min<uint32_t>(m_maxBatchAbsolute, m_appliedOpen / m_maxBatchRelative));
+    }
+
+    //the assign pass needs at least one open pixel per color
+    return std::max<uint32_t>(1, std::min<uint32_t>(m_batchLimit, m_appliedOpen));
+}
+
+void ComputeGenerator::updateBatchLimit(FrameData& frameData) {
+    auto now = std::chrono::steady_clock::now();
+    auto& window = m_batchWindow;
+
+    if (window.batches == 0) {
+        window.start = frameData.submitTime;
+    }
+
+    window.placed += frameData.placed;
+    window.dispatched += frameData.placed + frameData.rejected;
+    window.rejected += frameData.rejected;
+    window.gpuTime += frameData.gpuTime;
+    window.latency += frameData.latency;
+    window.cpuTime += frameData.cpuTime;
+    window.batches++;
+
+    double elapsed = std::chrono::duration<double>(now - window.start).count();
+    if (elapsed < BATCH_WINDOW) return;
+
+    double throughput = window.placed / elapsed;
+    double collisionRate = window.dispatched > 0 ? static_cast<double>(window.rejected) / window.dispatched : 0.0;
+    uint32_t previous = m_batchLimit;
+    const char* reason;
+
+    //climb towards the best placed pixels per second, but never past the collision budget
+    if (collisionRate > m_collisionCeiling) {
+        m_batchStep = 0.8f;
+        reason = "over collision ceiling";
+    } else if (throughput < m_lastThroughput) {
+        m_batchStep = 1.0f / m_batchStep;
+        reason = "throughput fell";
+    } else {
+        reason = "throughput rose";
+    }
+
+    uint32_t next = static_cast<uint32_t>(m_batchLimit * m_batchStep);
+    if (next == m_batchLimit) {
+        next += m_batchStep > 1.0f ? 1 : -1;
+    }
+
+    m_batchLimit = std::max<uint32_t>(1, std::min<uint32_t>(m_maxBatchLimit, next));
+    m_lastThroughput = throughput;
+
+    std::lock_guard<std::mutex> lock(outputMutex());
+    std::cout << std::setprecision(1) << std::fixed;
+    std::cout << "Batch: " << previous << " -> " << m_batchLimit << " (" << reason << ", "
+        << static_cast<size_t>(throughput) << " pps, "
+        << 100.0 * collisionRate << "% collisions, ";
+
+    //without timestamp queries only the latency is known
+    if (m_profiler->enabled()) {
+        std::cout << 1000.0 * window.gpuTime / window.batches << "ms gpu, ";
+    }
+
+    std::cout << 1000.0 * window.latency / window.batches << "ms latency, "
+        << 1000.0 * window.cpuTime / window.batches << "ms cpu)\n";
+
+    window = {};
+}
+
+void ComputeGenerator::resizeBatchBuffers(uint32_t capacity) {
+    {
+        std::lock_guard<std::mutex> lock(outputMutex());
+        std::cout << "Batch buffers: " << m_batchCapacity << " -> " << capacity << " colors\n";
+    }
+
+    m_batchCapacity = capacity;
+    m_updateCapacity = m_frames * m_batchCapacity + 1;
+
+    //nothing is in flight, so the old buffers can go before the new ones are allocated
+    for (auto& frameData : m_frameData) {
+        frameData.colorBuffer.reset();
+        frameData.outputBuffer.reset();
+        frameData.boundsBuffer.reset();
+        frameData.resultBuffer.reset();
+        frameData.assignmentBuffer.reset();
+        frameData.claimBuffer.reset();
+        frameData.readbackBuffer.reset();
+        frameData.updateBuffer.reset();
+
+        for (auto& alloc : frameData.allocations) {
+            m_allocator->free(alloc);
+        }
+
+        frameData.allocations.clear();
+    }
+
+    //both queues were drained by this thread and the readback thread is idle
+    m_placements = std::make_unique<LockFreeQueue<Placement>>(m_updateCapacity);
+    m_rejected = std::make_unique<LockFreeQueue<Color32>>(m_updateCapacity);
+
+    createColorBuffers();
+    createOutputBuffers();
+    createUpdateBuffers();
+    writeDescriptors();
+}
+
+void ComputeGenerator::drainQueues() {
+    Placement placement;
+    while (m_placements->pop(placement)) {
+        m_writes.push_back(placement);
+        m_appliedOpened = placement.opened;
+        m_appliedOpen = placement.open;
+    }
+
+    Color32 color;
+    while (m_rejected->pop(color)) {
+        m_retry.push_back(color);
+    }
+}
+
+struct UpdateData {
     glm::ivec4 color;
+    glm::ivec4 key;
     glm::ivec2 pos;
+    glm::ivec2 padding;
 };
 
-struct MainPushConstants {
+struct UpdatePushConstants {
     uint32_t count;
 };
 
-void ComputeGenerator::record(vk::CommandBuffer& commandBuffer, std::vector<glm::ivec2>& openList, std::vector<Color32>& colors, size_t index, uint32_t batchSize) {
+struct Score {
+    uint32_t score;
+    uint32_t index;
+};
+
+struct AssignPushConstants {
+    uint32_t batchSize;
+    uint32_t claimMask;
+};
+
+struct FrontierPushConstants {
+    uint32_t mode;
+    uint32_t batchSize;
+};
+
+void ComputeGenerator::record(vk::CommandBuffer& commandBuffer, size_t index, uint32_t batchSize) {
     auto& frameData = m_frameData[index];
+    uint32_t slot = static_cast<uint32_t>(index);
+
+    m_profiler->begin(commandBuffer, slot);
+
+    //batches are not chained with semaphores, so order them against the previous one here
+    recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead | vk::AccessFlags::ShaderWrite, vk::PipelineStageFlags::ComputeShader);
 
     vk::ImageMemoryBarrier barrier = {};
     barrier.image = m_texture.get();
@@ -183,89 +505,195 @@ void ComputeGenerator::record(vk::CommandBuffer& commandBuffer, std::vector<glm:
 
     commandBuffer.pipelineBarrier(vk::PipelineStageFlags::ComputeShader, vk::PipelineStageFlags::ComputeShader, {}, {}, {}, { barrier });
 
-    //update image
-    while (m_queue.size() > 0) {
-        auto item = m_queue.front();
-        m_queue.pop();
+    //update image and frontier, one thread per placed pixel
+    UpdateData* updatePtr = static_cast<UpdateData*>(frameData.updateMapping);
+    uint32_t updateCount = static_cast<uint32_t>(m_writes.size());
+
+    for (uint32_t i = 0; i < updateCount; i++) {
+        auto& item = m_writes[i];
+        Color32 key = m_metric.getKey(item.color);
+        updatePtr[i].color = glm::ivec4{ item.color.r, item.color.g, item.color.b, 255 };
+        updatePtr[i].key = glm::ivec4{ key.r, key.g, key.b, 255 };
+        updatePtr[i].pos = item.pos;
+    }
 
+    m_writes.clear();
+
+    if (updateCount > 0) {
         commandBuffer.bindPipeline(vk::PipelineBindPoint::Compute, *m_updatePipeline);
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::Compute, *m_updatePipelineLayout, 0, { *frameData.descriptor }, {});
 
         UpdatePushConstants updateConstants = {};
-        updateConstants.color = glm::ivec4{ item.color.r, item.color.g, item.color.b, 255 };
-        updateConstants.pos = item.pos;
+        updateConstants.count = updateCount;
 
         commandBuffer.pushConstants(*m_updatePipelineLayout, vk::ShaderStageFlags::Compute, 0, sizeof(UpdatePushConstants), &updateConstants);
-        commandBuffer.dispatch(1, 1, 1);
+        commandBuffer.dispatch(getWorkGroupCount(updateCount), 1, 1);
     }
 
     barrier.srcAccessMask = vk::AccessFlags::ShaderWrite;
     barrier.dstAccessMask = vk::AccessFlags::ShaderRead;
 
     commandBuffer.pipelineBarrier(vk::PipelineStageFlags::ComputeShader, vk::PipelineStageFlags::ComputeShader, {}, {}, {}, { barrier });
+    recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead | vk::AccessFlags::ShaderWrite, vk::PipelineStageFlags::ComputeShader);
+    m_profiler->mark(commandBuffer, slot, STAGE_UPDATE);
 
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::Compute, *m_mainPipeline);
+    //placed pixels stay in the list until more than half of it is dead, then it is compacted
+    uint32_t liveCount = m_appliedOpen;
+    uint32_t frontierCount = m_appliedOpened - m_compactedCount;
+    if (frontierCount - liveCount > liveCount) {
+        recordFrontier(commandBuffer, index, FRONTIER_ARGS, batchSize);
+        recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead | vk::AccessFlags::ShaderWrite | vk::AccessFlags::IndirectCommandRead,
+            vk::PipelineStageFlags::ComputeShader | vk::PipelineStageFlags::DrawIndirect);
+
+        recordFrontier(commandBuffer, index, FRONTIER_GATHER, batchSize);
+        recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead | vk::AccessFlags::ShaderWrite, vk::PipelineStageFlags::ComputeShader);
+
+        recordFrontier(commandBuffer, index, FRONTIER_COPY, batchSize);
+        recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead | vk::AccessFlags::ShaderWrite, vk::PipelineStageFlags::ComputeShader);
+
+        m_compactedCount = m_appliedOpened - liveCount;
+    }
+
+    recordFrontier(commandBuffer, index, FRONTIER_ARGS, batchSize);
+    recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead | vk::AccessFlags::IndirectCommandRead,
+        vk::PipelineStageFlags::ComputeShader | vk::PipelineStageFlags::DrawIndirect);
+    m_profiler->mark(commandBuffer, slot, STAGE_FRONTIER);
+
+    //the score each color is sure to reach, so the main pass can skip tiles that cannot beat it
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Compute, *m_boundsPipeline);
     commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::Compute, *m_mainPipelineLayout, 0, { *frameData.descriptor }, {});
+    commandBuffer.dispatch(batchSize, 1, 1);
+    recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead, vk::PipelineStageFlags::ComputeShader);
+    m_profiler->mark(commandBuffer, slot, STAGE_BOUNDS);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Compute, *m_mainPipeline);
+    commandBuffer.dispatchIndirect(*m_frontierInfoBuffer, offsetof(FrontierInfo, mainDispatch));
+    m_profiler->mark(commandBuffer, slot, STAGE_MAIN);
+
+    //finish the argmin on the GPU, one workgroup per batch color
+    recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead, vk::PipelineStageFlags::ComputeShader);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Compute, *m_reducePipeline);
+    commandBuffer.dispatch(batchSize, 1, 1);
+    m_profiler->mark(commandBuffer, slot, STAGE_REDUCE);
+
+    //give every color of the batch its own pixel out of its candidates
+    recordBarrier(commandBuffer, vk::AccessFlags::ShaderRead, vk::PipelineStageFlags::ComputeShader);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Compute, *m_assignPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::Compute, *m_assignPipelineLayout, 0, { *frameData.descriptor }, {});
+
+    AssignPushConstants assignConstants = {};
+    assignConstants.batchSize = batchSize;
+    assignConstants.claimMask = getClaimCount() - 1;
+
+    commandBuffer.pushConstants(*m_assignPipelineLayout, vk::ShaderStageFlags::Compute, 0, sizeof(AssignPushConstants), &assignConstants);
+    commandBuffer.dispatch(1, 1, 1);
+    m_profiler->mark(commandBuffer, slot, STAGE_ASSIGN);
 
-    MainPushConstants mainConstants = {};
-    mainConstants.count = static_cast<uint32_t>(openList.size());
+    recordBarrier(commandBuffer, vk::AccessFlags::TransferRead, vk::PipelineStageFlags::Transfer);
 
-    commandBuffer.pushConstants(*m_mainPipelineLayout, vk::ShaderStageFlags::Compute, 0, sizeof(MainPushConstants), &mainConstants);
+    vk::BufferCopy copy = {};
+    copy.size = sizeof(glm::uvec4) * batchSize;
 
-    uint32_t mainGroups = getWorkGroupCount(openList.size());
-    commandBuffer.dispatch(mainGroups, batchSize, 1);
+    commandBuffer.copyBuffer(*frameData.assignmentBuffer, *frameData.readbackBuffer, copy);
 
     vk::BufferMemoryBarrier bufferBarrier = {};
-    bufferBarrier.buffer = frameData.outputBuffer.get();
+    bufferBarrier.buffer = frameData.readbackBuffer.get();
     bufferBarrier.size = VK_WHOLE_SIZE;
-    bufferBarrier.srcAccessMask = vk::AccessFlags::ShaderWrite | vk::AccessFlags::ShaderRead;
+    bufferBarrier.srcAccessMask = vk::AccessFlags::TransferWrite;
     bufferBarrier.dstAccessMask = vk::AccessFlags::HostRead;
     bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
-    commandBuffer.pipelineBarrier(vk::PipelineStageFlags::ComputeShader, vk::PipelineStageFlags::Host, {}, {}, { bufferBarrier }, {});
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlags::Transfer, vk::PipelineStageFlags::Host, {}, {}, { bufferBarrier }, {});
+    m_profiler->mark(commandBuffer, slot, STAGE_COPY);
 }
 
-struct Score {
-    uint32_t score;
-    uint32_t index;
-};
+void ComputeGenerator::recordFrontier(vk::CommandBuffer& commandBuffer, size_t index, uint32_t mode, uint32_t batchSize) {
+    auto& frameData = m_frameData[index];
 
-void ComputeGenerator::readResult(size_t index, std::vector<glm::ivec2>& openList, std::vector<Color32>& colors) {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::Compute, *m_frontierPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::Compute, *m_frontierPipelineLayout, 0, { *frameData.descriptor }, {});
+
+    FrontierPushConstants constants = {};
+    constants.mode = mode;
+    constants.batchSize = batchSize;
+
+    commandBuffer.pushConstants(*m_frontierPipelineLayout, vk::ShaderStageFlags::Compute, 0, sizeof(FrontierPushConstants), &constants);
+
+    if (mode == FRONTIER_ARGS) {
+        commandBuffer.dispatch(1, 1, 1);
+    } else {
+        commandBuffer.dispatchIndirect(*m_frontierInfoBuffer, offsetof(FrontierInfo, compactDispatch));
+    }
+}
+
+void ComputeGenerator::recordBarrier(vk::CommandBuffer& commandBuffer, vk::AccessFlags dstAccess, vk::PipelineStageFlags dstStage) {
+    vk::MemoryBarrier barrier = {};
+    barrier.srcAccessMask = vk::AccessFlags::ShaderWrite;
+    barrier.dstAccessMask = dstAccess;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlags::ComputeShader, dstStage, {}, { barrier }, {}, {});
+}
+
+void ComputeGenerator::readResult(size_t index) {
     auto& frameData = m_frameData[index];
+    auto& colors = frameData.colors;
 
-    Score* readBack = static_cast<Score*>(frameData.outputMapping);
-    uint32_t workGroupCount = getWorkGroupCount(openList.size());
+    glm::uvec4* readBack = static_cast<glm::uvec4*>(frameData.readbackMapping);
+    uint32_t collisions = 0;
+    frameData.placed = 0;
 
     for (uint32_t i = 0; i < colors.size(); i++) {
-        uint32_t start = i * getWorkGroupCount(m_size.x * m_size.y);
-        uint32_t bestScore = std::numeric_limits<uint32_t>::max();
-        uint32_t result = 0;
-
-        for (uint32_t j = 0; j < workGroupCount; j++) {
-            Score score = readBack[start + j];
-            if (score.score < bestScore) {
-                result = score.index;
-                bestScore = score.score;
+        uint32_t result = readBack[i].x;
+        bool placed = false;
+
+        if (result != UMAX) {
+            //the shader reports the winning pixel, not its slot in the frontier list
+            glm::ivec2 pos = { static_cast<int32_t>(result % m_size.x), static_cast<int32_t>(result / m_size.x) };
+            Color32& existingColor = m_bitmap.getPixel(pos.x, pos.y);
+            if (existingColor.a == 0) {
+                m_colorQueue->enqueue(pos, colors[i]);
+                existingColor = colors[i];
+                addNeighborsToOpenSet(pos);
+                m_openSet.erase(pos);
+                m_placedCount++;
+                frameData.placed++;
+                placed = true;
+
+                while (!m_placements->push({ colors[i], pos, m_openedCount, static_cast<uint32_t>(m_openSet.size()) })) {
+                    std::this_thread::yield();
+                }
+            } else {
+                collisions++;
             }
         }
 
-        glm::ivec2 pos = openList[result];
-        Color32& existingColor = m_bitmap.getPixel(pos.x, pos.y);
-        if (existingColor.a == 0) {
-            m_colorQueue->enqueue(pos, colors[i]);
-            existingColor = colors[i];
-            addNeighborsToOpenSet(pos);
-            m_openSet.erase(pos);
-            m_queue.push({ colors[i], pos });
-        } else {
-            m_source->resubmit(colors[i]);
+        if (!placed) {
+            while (!m_rejected->push(colors[i])) {
+                std::this_thread::yield();
+            }
         }
     }
+
+    m_dispatchedCount += colors.size();
+    frameData.rejected = static_cast<uint32_t>(colors.size()) - frameData.placed;
+
+    if (colors.size() > 0) {
+        float rate = static_cast<float>(collisions) / colors.size();
+        float average = m_collisionRate->load(std::memory_order_relaxed);
+        m_collisionRate->store(average * 0.9f + rate * 0.1f, std::memory_order_relaxed);
+    }
+
+    colors.clear();
 }
 
 void ComputeGenerator::addToOpenSet(glm::ivec2 pos) {
-    m_openSet.insert(pos);
+    //mirrors the GPU frontier list, which only ever appends newly opened pixels
+    if (m_openSet.insert(pos).second) {
+        m_openedCount++;
+    }
 }
 
 void ComputeGenerator::addNeighborsToOpenSet(glm::ivec2 pos) {
@@ -301,16 +729,34 @@ void ComputeGenerator::createCommandPool() {
 void ComputeGenerator::createCommandBuffers() {
     vk::CommandBufferAllocateInfo info = {};
     info.commandPool = m_commandPool.get();
-    info.commandBufferCount = FRAMES;
+    info.commandBufferCount = m_frames;
 
     auto commandBuffers = m_commandPool->allocate(info);
 
-    for (size_t i = 0; i < FRAMES; i++) {
+    for (size_t i = 0; i < m_frames; i++) {
         m_frameData[i].commandBuffer = std::make_unique<vk::CommandBuffer>(std::move(commandBuffers[i]));
     }
 }
 
 void ComputeGenerator::createTexture() {
+    //the renderer samples this image directly through a unorm view
+    m_texture = createStorageImage(vk::ImageUsageFlags::Storage | vk::ImageUsageFlags::TransferDst | vk::ImageUsageFlags::Sampled,
+        vk::ImageCreateFlags::MutableFormat);
+}
+
+void ComputeGenerator::createTextureView() {
+    m_textureView = createStorageImageView(*m_texture);
+}
+
+void ComputeGenerator::createKeyTexture() {
+    //keys only differ from the displayed colors when another metric is used, otherwise the texture is scored directly
+    if (m_metric.type() == Metric::RGB) return;
+
+    m_keyTexture = createStorageImage(vk::ImageUsageFlags::Storage, {});
+    m_keyTextureView = createStorageImageView(*m_keyTexture);
+}
+
+std::unique_ptr<vk::Image> ComputeGenerator::createStorageImage(vk::ImageUsageFlags usage, vk::ImageCreateFlags flags) {
     vk::ImageCreateInfo info = {};
     info.format = vk::Format::R8G8B8A8_Uint;
     info.extent = { static_cast<uint32_t>(m_size.x), static_cast<uint32_t>(m_size.y), 1 };
@@ -319,17 +765,26 @@ void ComputeGenerator::createTexture() {
     info.initialLayout = vk::ImageLayout::Undefined;
     info.mipLevels = 1;
     info.samples = vk::SampleCountFlags::_1;
-    info.usage = vk::ImageUsageFlags::Storage | vk::ImageUsageFlags::TransferDst;
+    info.usage = usage;
+    info.flags = flags;
+
+    if (m_core->graphicsQueueFamilyIndex() != m_core->computeQueueFamilyIndex()) {
+        info.sharingMode = vk::SharingMode::Concurrent;
+        info.queueFamilyIndices = { m_core->graphicsQueueFamilyIndex(), m_core->computeQueueFamilyIndex() };
+    } else {
+        info.sharingMode = vk::SharingMode::Exclusive;
+    }
 
-    m_texture = std::make_unique<vk::Image>(m_core->device(), info);
+    auto image = std::make_unique<vk::Image>(m_core->device(), info);
 
-    Allocation alloc = m_allocator->allocate(m_texture->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::DeviceLocal);
-    m_texture->bind(*alloc.memory, alloc.offset);
+    Allocation alloc = m_allocator->allocate(image->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::DeviceLocal);
+    image->bind(*alloc.memory, alloc.offset);
+    m_allocations.push_back(alloc);
 
     vk::CommandBuffer commandBuffer = m_core->getSingleUseCommandBuffer();
 
     vk::ImageMemoryBarrier barrier = {};
-    barrier.image = m_texture.get();
+    barrier.image = image.get();
     barrier.oldLayout = vk::ImageLayout::Undefined;
     barrier.newLayout = vk::ImageLayout::General;
     barrier.srcAccessMask = vk::AccessFlags::None;
@@ -346,12 +801,14 @@ void ComputeGenerator::createTexture() {
         {}, {}, { barrier });
 
     m_core->submitSingleUseCommandBuffer(std::move(commandBuffer));
+
+    return image;
 }
 
-void ComputeGenerator::createTextureView() {
+std::unique_ptr<vk::ImageView> ComputeGenerator::createStorageImageView(vk::Image& image) {
     vk::ImageViewCreateInfo info = {};
-    info.image = m_texture.get();
-    info.format = m_texture->format();
+    info.image = &image;
+    info.format = image.format();
     info.viewType = vk::ImageViewType::_2D;
     info.subresourceRange.aspectMask = vk::ImageAspectFlags::Color;
     info.subresourceRange.baseMipLevel = 0;
@@ -359,33 +816,73 @@ void ComputeGenerator::createTextureView() {
     info.subresourceRange.baseArrayLayer = 0;
     info.subresourceRange.layerCount = 1;
 
-    m_textureView = std::make_unique<vk::ImageView>(m_core->device(), info);
+    return std::make_unique<vk::ImageView>(m_core->device(), info);
 }
 
-void ComputeGenerator::createPositionBuffers() {
-    for (size_t i = 0; i < FRAMES; i++) {
-        auto& frameData = m_frameData[i];
+void ComputeGenerator::createFrontierBuffers() {
+    size_t pixels = static_cast<size_t>(m_size.x) * m_size.y;
 
-        vk::BufferCreateInfo info = {};
-        info.size = sizeof(glm::ivec2) * m_size.x * m_size.y;
-        info.usage = vk::BufferUsageFlags::StorageBuffer;
+    m_frontierBuffer = createDeviceBuffer(sizeof(glm::ivec2) * pixels, vk::BufferUsageFlags::StorageBuffer);
+    m_scratchBuffer = createDeviceBuffer(sizeof(glm::ivec2) * pixels, vk::BufferUsageFlags::StorageBuffer);
+    m_stateBuffer = createDeviceBuffer(sizeof(uint32_t) * pixels, vk::BufferUsageFlags::StorageBuffer | vk::BufferUsageFlags::TransferDst);
+    m_frontierInfoBuffer = createDeviceBuffer(sizeof(FrontierInfo),
+        vk::BufferUsageFlags::StorageBuffer | vk::BufferUsageFlags::IndirectBuffer | vk::BufferUsageFlags::TransferDst);
 
-        frameData.positionBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+    size_t tiles = static_cast<size_t>((m_size.x + TILE_SIZE - 1) / TILE_SIZE) * ((m_size.y + TILE_SIZE - 1) / TILE_SIZE);
 
-        Allocation alloc = m_allocator->allocate(frameData.positionBuffer->requirements(),
-            vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent | vk::MemoryPropertyFlags::DeviceLocal,
-            vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent);
-        frameData.positionBuffer->bind(*alloc.memory, alloc.offset);
-        frameData.positionMapping = m_allocator->getMapping(alloc.memory, alloc.offset);
+    //the tile list is followed by scratch space for compacting it
+    m_tileBuffer = createDeviceBuffer(sizeof(Tile) * tiles, vk::BufferUsageFlags::StorageBuffer | vk::BufferUsageFlags::TransferDst);
+    m_tileListBuffer = createDeviceBuffer(sizeof(uint32_t) * tiles * 2, vk::BufferUsageFlags::StorageBuffer);
+
+    //the 3x3 ring is scored from the image, so the sums only need a placeholder
+    size_t sumCount = m_radius > 1 ? pixels : 1;
+    m_sumBuffer = createDeviceBuffer(sizeof(NeighborSums) * sumCount, vk::BufferUsageFlags::StorageBuffer | vk::BufferUsageFlags::TransferDst);
+
+    vk::CommandBuffer commandBuffer = m_core->getSingleUseCommandBuffer();
+
+    commandBuffer.fillBuffer(*m_stateBuffer, 0, VK_WHOLE_SIZE, 0);
+    commandBuffer.fillBuffer(*m_frontierInfoBuffer, 0, VK_WHOLE_SIZE, 0);
+    commandBuffer.fillBuffer(*m_tileBuffer, 0, VK_WHOLE_SIZE, 0);
+    commandBuffer.fillBuffer(*m_sumBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    vk::MemoryBarrier barrier = {};
+    barrier.srcAccessMask = vk::AccessFlags::TransferWrite;
+    barrier.dstAccessMask = vk::AccessFlags::ShaderRead | vk::AccessFlags::ShaderWrite;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlags::Transfer, vk::PipelineStageFlags::ComputeShader, vk::DependencyFlags::None,
+        { barrier }, {}, {});
+
+    m_core->submitSingleUseCommandBuffer(std::move(commandBuffer));
+}
+
+std::unique_ptr<vk::Buffer> ComputeGenerator::createDeviceBuffer(size_t size, vk::BufferUsageFlags usage) {
+    vk::BufferCreateInfo info = {};
+    info.size = size;
+    info.usage = usage;
+
+    //initialized on the graphics queue, then only used by compute
+    if (m_core->graphicsQueueFamilyIndex() != m_core->computeQueueFamilyIndex()) {
+        info.sharingMode = vk::SharingMode::Concurrent;
+        info.queueFamilyIndices = { m_core->graphicsQueueFamilyIndex(), m_core->computeQueueFamilyIndex() };
+    } else {
+        info.sharingMode = vk::SharingMode::Exclusive;
     }
+
+    auto buffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+
+    Allocation alloc = m_allocator->allocate(buffer->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::None);
+    buffer->bind(*alloc.memory, alloc.offset);
+    m_allocations.push_back(alloc);
+
+    return buffer;
 }
 
 void ComputeGenerator::createColorBuffers() {
-    for (size_t i = 0; i < FRAMES; i++) {
+    for (size_t i = 0; i < m_frames; i++) {
         auto& frameData = m_frameData[i];
 
         vk::BufferCreateInfo info = {};
-        info.size = sizeof(glm::ivec4) * m_maxBatchAbsolute;
+        info.size = sizeof(glm::ivec4) * m_batchCapacity;
         info.usage = vk::BufferUsageFlags::StorageBuffer;
 
         frameData.colorBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
@@ -394,25 +891,91 @@ void ComputeGenerator::createColorBuffers() {
             vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent | vk::MemoryPropertyFlags::DeviceLocal,
             vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent);
         frameData.colorBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
         frameData.colorMapping = m_allocator->getMapping(alloc.memory, alloc.offset);
     }
 }
 
 void ComputeGenerator::createOutputBuffers() {
-    for (size_t i = 0; i < FRAMES; i++) {
+    for (size_t i = 0; i < m_frames; i++) {
         auto& frameData = m_frameData[i];
 
         vk::BufferCreateInfo info = {};
-        info.size = sizeof(Score) * getWorkGroupCount(m_size.x * m_size.y) * m_maxBatchAbsolute;
+        info.size = sizeof(Score) * getMainWorkGroupCount(m_size.x * m_size.y) * m_batchCapacity * CANDIDATES;
         info.usage = vk::BufferUsageFlags::StorageBuffer;
 
         frameData.outputBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
 
-        Allocation alloc = m_allocator->allocate(frameData.outputBuffer->requirements(),
+        Allocation alloc = m_allocator->allocate(frameData.outputBuffer->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::None);
+        frameData.outputBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
+
+        info.size = sizeof(uint32_t) * m_batchCapacity;
+
+        frameData.boundsBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+
+        alloc = m_allocator->allocate(frameData.boundsBuffer->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::None);
+        frameData.boundsBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
+
+        info.size = sizeof(Score) * m_batchCapacity * CANDIDATES;
+
+        frameData.resultBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+
+        alloc = m_allocator->allocate(frameData.resultBuffer->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::None);
+        frameData.resultBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
+
+        info.size = sizeof(glm::uvec4) * m_batchCapacity;
+        info.usage = vk::BufferUsageFlags::StorageBuffer | vk::BufferUsageFlags::TransferSrc;
+
+        frameData.assignmentBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+
+        alloc = m_allocator->allocate(frameData.assignmentBuffer->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::None);
+        frameData.assignmentBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
+
+        //a hash table over the candidate pixels, so contested pixels are resolved with atomics
+        vk::BufferCreateInfo claimInfo = {};
+        claimInfo.size = sizeof(glm::uvec4) * getClaimCount();
+        claimInfo.usage = vk::BufferUsageFlags::StorageBuffer;
+
+        frameData.claimBuffer = std::make_unique<vk::Buffer>(m_core->device(), claimInfo);
+
+        alloc = m_allocator->allocate(frameData.claimBuffer->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::None);
+        frameData.claimBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
+
+        //only the assigned pixel of each color is read back
+        info.usage = vk::BufferUsageFlags::TransferDst;
+
+        frameData.readbackBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+
+        alloc = m_allocator->allocate(frameData.readbackBuffer->requirements(),
             vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent | vk::MemoryPropertyFlags::HostCached,
             vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent);
-        frameData.outputBuffer->bind(*alloc.memory, alloc.offset);
-        frameData.outputMapping = m_allocator->getMapping(alloc.memory, alloc.offset);
+        frameData.readbackBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
+        frameData.readbackMapping = m_allocator->getMapping(alloc.memory, alloc.offset);
+    }
+}
+
+void ComputeGenerator::createUpdateBuffers() {
+    for (size_t i = 0; i < m_frames; i++) {
+        auto& frameData = m_frameData[i];
+
+        vk::BufferCreateInfo info = {};
+        info.size = sizeof(UpdateData) * m_updateCapacity;
+        info.usage = vk::BufferUsageFlags::StorageBuffer;
+
+        frameData.updateBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+
+        Allocation alloc = m_allocator->allocate(frameData.updateBuffer->requirements(),
+            vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent | vk::MemoryPropertyFlags::DeviceLocal,
+            vk::MemoryPropertyFlags::HostVisible | vk::MemoryPropertyFlags::HostCoherent);
+        frameData.updateBuffer->bind(*alloc.memory, alloc.offset);
+        frameData.allocations.push_back(alloc);
+        frameData.updateMapping = m_allocator->getMapping(alloc.memory, alloc.offset);
     }
 }
 
@@ -441,8 +1004,81 @@ void ComputeGenerator::createDescriptorSetLayout() {
     binding3.descriptorCount = 1;
     binding3.stageFlags = vk::ShaderStageFlags::Compute;
 
+    vk::DescriptorSetLayoutBinding binding4 = {};
+    binding4.binding = 4;
+    binding4.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding4.descriptorCount = 1;
+    binding4.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding5 = {};
+    binding5.binding = 5;
+    binding5.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding5.descriptorCount = 1;
+    binding5.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding6 = {};
+    binding6.binding = 6;
+    binding6.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding6.descriptorCount = 1;
+    binding6.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding7 = {};
+    binding7.binding = 7;
+    binding7.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding7.descriptorCount = 1;
+    binding7.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding8 = {};
+    binding8.binding = 8;
+    binding8.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding8.descriptorCount = 1;
+    binding8.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding9 = {};
+    binding9.binding = 9;
+    binding9.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding9.descriptorCount = 1;
+    binding9.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding10 = {};
+    binding10.binding = 10;
+    binding10.descriptorType = vk::DescriptorType::StorageImage;
+    binding10.descriptorCount = 1;
+    binding10.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding11 = {};
+    binding11.binding = 11;
+    binding11.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding11.descriptorCount = 1;
+    binding11.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding12 = {};
+    binding12.binding = 12;
+    binding12.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding12.descriptorCount = 1;
+    binding12.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding13 = {};
+    binding13.binding = 13;
+    binding13.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding13.descriptorCount = 1;
+    binding13.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding14 = {};
+    binding14.binding = 14;
+    binding14.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding14.descriptorCount = 1;
+    binding14.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::DescriptorSetLayoutBinding binding15 = {};
+    binding15.binding = 15;
+    binding15.descriptorType = vk::DescriptorType::StorageBuffer;
+    binding15.descriptorCount = 1;
+    binding15.stageFlags = vk::ShaderStageFlags::Compute;
+
     vk::DescriptorSetLayoutCreateInfo info = {};
-    info.bindings = { binding0, binding1, binding2, binding3 };
+    info.bindings = { binding0, binding1, binding2, binding3, binding4, binding5, binding6, binding7, binding8, binding9, binding10,
+        binding11, binding12, binding13, binding14, binding15 };
 
     m_descriptorSetLayout = std::make_unique<vk::DescriptorSetLayout>(m_core->device(), info);
 }
@@ -450,14 +1086,14 @@ void ComputeGenerator::createDescriptorSetLayout() {
 void ComputeGenerator::createDescriptorPool() {
     vk::DescriptorPoolSize size0 = {};
     size0.type = vk::DescriptorType::StorageImage;
-    size0.descriptorCount = 1 * FRAMES;
+    size0.descriptorCount = 2 * m_frames;
 
     vk::DescriptorPoolSize size1 = {};
     size1.type = vk::DescriptorType::StorageBuffer;
-    size1.descriptorCount = 3 * FRAMES;
+    size1.descriptorCount = 14 * m_frames;
 
     vk::DescriptorPoolCreateInfo info = {};
-    info.maxSets = FRAMES;
+    info.maxSets = m_frames;
     info.poolSizes = { size0, size1 };
 
     m_descriptorPool = std::make_unique<vk::DescriptorPool>(m_core->device(), info);
@@ -466,26 +1102,32 @@ void ComputeGenerator::createDescriptorPool() {
 void ComputeGenerator::createDescriptorSets() {
     vk::DescriptorSetAllocateInfo info = {};
     info.descriptorPool = m_descriptorPool.get();
-    info.setLayouts = { *m_descriptorSetLayout, *m_descriptorSetLayout };
+    for (size_t i = 0; i < m_frames; i++) {
+        info.setLayouts.push_back(*m_descriptorSetLayout);
+    }
     
     auto descriptorSets = m_descriptorPool->allocate(info);
 
-    for (size_t i = 0; i < FRAMES; i++) {
+    for (size_t i = 0; i < m_frames; i++) {
         m_frameData[i].descriptor = std::make_unique<vk::DescriptorSet>(std::move(descriptorSets[i]));
     }
 }
 
 void ComputeGenerator::writeDescriptors() {
-    for (size_t i = 0; i < FRAMES; i++) {
+    for (size_t i = 0; i < m_frames; i++) {
         auto& frameData = m_frameData[i];
 
         vk::DescriptorImageInfo imageInfo = {};
         imageInfo.imageView = m_textureView.get();
         imageInfo.imageLayout = vk::ImageLayout::General;
 
+        vk::DescriptorImageInfo keyImageInfo = {};
+        keyImageInfo.imageView = m_keyTextureView != nullptr ? m_keyTextureView.get() : m_textureView.get();
+        keyImageInfo.imageLayout = vk::ImageLayout::General;
+
         vk::DescriptorBufferInfo bufferInfo0 = {};
-        bufferInfo0.buffer = frameData.positionBuffer.get();
-        bufferInfo0.range = frameData.positionBuffer->size();
+        bufferInfo0.buffer = m_frontierBuffer.get();
+        bufferInfo0.range = m_frontierBuffer->size();
 
         vk::DescriptorBufferInfo bufferInfo1 = {};
         bufferInfo1.buffer = frameData.colorBuffer.get();
@@ -495,6 +1137,50 @@ void ComputeGenerator::writeDescriptors() {
         bufferInfo2.buffer = frameData.outputBuffer.get();
         bufferInfo2.range = frameData.outputBuffer->size();
 
+        vk::DescriptorBufferInfo bufferInfo3 = {};
+        bufferInfo3.buffer = frameData.updateBuffer.get();
+        bufferInfo3.range = frameData.updateBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo4 = {};
+        bufferInfo4.buffer = m_frontierInfoBuffer.get();
+        bufferInfo4.range = m_frontierInfoBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo5 = {};
+        bufferInfo5.buffer = m_scratchBuffer.get();
+        bufferInfo5.range = m_scratchBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo6 = {};
+        bufferInfo6.buffer = m_stateBuffer.get();
+        bufferInfo6.range = m_stateBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo7 = {};
+        bufferInfo7.buffer = frameData.resultBuffer.get();
+        bufferInfo7.range = frameData.resultBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo8 = {};
+        bufferInfo8.buffer = frameData.assignmentBuffer.get();
+        bufferInfo8.range = frameData.assignmentBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo9 = {};
+        bufferInfo9.buffer = m_tileBuffer.get();
+        bufferInfo9.range = m_tileBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo10 = {};
+        bufferInfo10.buffer = m_tileListBuffer.get();
+        bufferInfo10.range = m_tileListBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo11 = {};
+        bufferInfo11.buffer = frameData.boundsBuffer.get();
+        bufferInfo11.range = frameData.boundsBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo12 = {};
+        bufferInfo12.buffer = m_sumBuffer.get();
+        bufferInfo12.range = m_sumBuffer->size();
+
+        vk::DescriptorBufferInfo bufferInfo13 = {};
+        bufferInfo13.buffer = frameData.claimBuffer.get();
+        bufferInfo13.range = frameData.claimBuffer->size();
+
         vk::WriteDescriptorSet write0 = {};
         write0.dstSet = frameData.descriptor.get();
         write0.dstBinding = 0;
@@ -519,7 +1205,80 @@ void ComputeGenerator::writeDescriptors() {
         write3.bufferInfo = { bufferInfo2 };
         write3.descriptorType = vk::DescriptorType::StorageBuffer;
 
-        vk::DescriptorSet::update(m_core->device(), { write0, write1, write2, write3 }, {});
+        vk::WriteDescriptorSet write4 = {};
+        write4.dstSet = frameData.descriptor.get();
+        write4.dstBinding = 4;
+        write4.bufferInfo = { bufferInfo3 };
+        write4.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write5 = {};
+        write5.dstSet = frameData.descriptor.get();
+        write5.dstBinding = 5;
+        write5.bufferInfo = { bufferInfo4 };
+        write5.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write6 = {};
+        write6.dstSet = frameData.descriptor.get();
+        write6.dstBinding = 6;
+        write6.bufferInfo = { bufferInfo5 };
+        write6.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write7 = {};
+        write7.dstSet = frameData.descriptor.get();
+        write7.dstBinding = 7;
+        write7.bufferInfo = { bufferInfo6 };
+        write7.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write8 = {};
+        write8.dstSet = frameData.descriptor.get();
+        write8.dstBinding = 8;
+        write8.bufferInfo = { bufferInfo7 };
+        write8.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write9 = {};
+        write9.dstSet = frameData.descriptor.get();
+        write9.dstBinding = 9;
+        write9.bufferInfo = { bufferInfo8 };
+        write9.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write10 = {};
+        write10.dstSet = frameData.descriptor.get();
+        write10.dstBinding = 10;
+        write10.imageInfo = { keyImageInfo };
+        write10.descriptorType = vk::DescriptorType::StorageImage;
+
+        vk::WriteDescriptorSet write11 = {};
+        write11.dstSet = frameData.descriptor.get();
+        write11.dstBinding = 11;
+        write11.bufferInfo = { bufferInfo9 };
+        write11.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write12 = {};
+        write12.dstSet = frameData.descriptor.get();
+        write12.dstBinding = 12;
+        write12.bufferInfo = { bufferInfo10 };
+        write12.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write13 = {};
+        write13.dstSet = frameData.descriptor.get();
+        write13.dstBinding = 13;
+        write13.bufferInfo = { bufferInfo11 };
+        write13.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write14 = {};
+        write14.dstSet = frameData.descriptor.get();
+        write14.dstBinding = 14;
+        write14.bufferInfo = { bufferInfo12 };
+        write14.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::WriteDescriptorSet write15 = {};
+        write15.dstSet = frameData.descriptor.get();
+        write15.dstBinding = 15;
+        write15.bufferInfo = { bufferInfo13 };
+        write15.descriptorType = vk::DescriptorType::StorageBuffer;
+
+        vk::DescriptorSet::update(m_core->device(), { write0, write1, write2, write3, write4, write5, write6, write7, write8, write9, write10,
+            write11, write12, write13, write14, write15 }, {});
     }
 }
 
@@ -536,51 +1295,143 @@ void ComputeGenerator::createUpdatePipelineLayout() {
 }
 
 void ComputeGenerator::createUpdatePipeline() {
-    vk::ShaderModule module = loadShader(m_core->device(), "shaders/update.comp.spv");
-
-    vk::PipelineShaderStageCreateInfo shaderInfo = {};
-    shaderInfo.module = &module;
-    shaderInfo.name = "main";
-    shaderInfo.stage = vk::ShaderStageFlags::Compute;
-
-    vk::ComputePipelineCreateInfo info = {};
-    info.stage = shaderInfo;
-    info.layout = m_updatePipelineLayout.get();
+    m_updatePipeline = buildUpdatePipeline(m_workGroupSize, static_cast<uint32_t>(m_radius));
+}
 
-    m_updatePipeline = std::make_unique<vk::ComputePipeline>(m_core->device(), info);
+std::unique_ptr<vk::Pipeline> ComputeGenerator::buildUpdatePipeline(uint32_t workGroupSize, uint32_t radius) {
+    return buildPipeline("shaders/update.comp.spv", { workGroupSize, radius }, *m_updatePipelineLayout);
 }
 
-void ComputeGenerator::createMainPipelineLayout() {
+void ComputeGenerator::createFrontierPipelineLayout() {
     vk::PushConstantRange range = {};
-    range.size = sizeof(MainPushConstants);
+    range.size = sizeof(FrontierPushConstants);
     range.stageFlags = vk::ShaderStageFlags::Compute;
 
     vk::PipelineLayoutCreateInfo info = {};
     info.setLayouts = { *m_descriptorSetLayout };
     info.pushConstantRanges = { range };
+
+    m_frontierPipelineLayout = std::make_unique<vk::PipelineLayout>(m_core->device(), info);
+}
+
+void ComputeGenerator::createFrontierPipeline() {
+    m_frontierPipeline = buildFrontierPipeline(m_workGroupSize, getMainWorkGroupCount(m_size.x * m_size.y));
+}
+
+std::unique_ptr<vk::Pipeline> ComputeGenerator::buildFrontierPipeline(uint32_t workGroupSize, uint32_t maxMainGroups) {
+    return buildPipeline("shaders/frontier.comp.spv", { workGroupSize, maxMainGroups }, *m_frontierPipelineLayout);
+}
+
+void ComputeGenerator::createMainPipelineLayout() {
+    vk::PipelineLayoutCreateInfo info = {};
+    info.setLayouts = { *m_descriptorSetLayout };
     
     m_mainPipelineLayout = std::make_unique<vk::PipelineLayout>(m_core->device(), info);
 }
 
 void ComputeGenerator::createMainPipeline(const std::string& shader) {
-    vk::ShaderModule module = loadShader(m_core->device(), shader);
+    m_mainPipeline = buildMainPipeline(shader, m_workGroupSize, getMainWorkGroupCount(m_size.x * m_size.y), static_cast<uint32_t>(m_radius));
+}
+
+std::unique_ptr<vk::Pipeline> ComputeGenerator::buildMainPipeline(const std::string& shader, uint32_t workGroupSize, uint32_t maxWorkGroups, uint32_t radius) {
+    std::string path = shader;
+
+    //same shader with the workgroup argmin done by subgroup operations
+    size_t extension = path.rfind(".comp.spv");
+    if (m_core->subgroupArithmetic() && extension != std::string::npos) {
+        path.insert(extension, ".subgroup");
+    }
+
+    //wave has no radius constant, which specialization allows
+    return buildPipeline(path, { workGroupSize, maxWorkGroups, radius }, *m_mainPipelineLayout);
+}
+
+void ComputeGenerator::prewarmPipelines() {
+    auto start = std::chrono::steady_clock::now();
+    size_t count = 0;
+
+    //the main pass count is capped, so image size no longer matters except for images too small to need a warm cache,
+    //leaving the workgroup size and the coral radius as the constants worth covering
+    uint32_t maxMainGroups = MAX_MAIN_WORK_GROUPS;
 
-    uint32_t specData[] = { m_workGroupSize, getWorkGroupCount(m_size.x * m_size.y) };
+    for (uint32_t workGroupSize : PREWARM_WORK_GROUP_SIZES) {
+        for (uint32_t radius = 1; radius <= MAX_RADIUS; radius++) {
+            buildUpdatePipeline(workGroupSize, radius);
+            buildMainPipeline("shaders/coral.comp.spv", workGroupSize, maxMainGroups, radius);
+            count += 2;
+        }
+
+        //wave only runs with a radius of 1
+        buildMainPipeline("shaders/wave.comp.spv", workGroupSize, maxMainGroups, 1);
+        buildFrontierPipeline(workGroupSize, maxMainGroups);
+        buildBoundsPipeline(workGroupSize);
+        buildReducePipeline(workGroupSize, maxMainGroups);
+        buildAssignPipeline(workGroupSize);
+        count += 5;
+    }
+
+    m_core->savePipelineCache();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lock(outputMutex());
+    std::cout << std::setprecision(2) << std::fixed;
+    std::cout << "Pipeline cache: prewarmed " << count << " pipeline variants in " << elapsed.count() << "s\n";
+}
+
+void ComputeGenerator::createBoundsPipeline() {
+    m_boundsPipeline = buildBoundsPipeline(m_workGroupSize);
+}
+
+std::unique_ptr<vk::Pipeline> ComputeGenerator::buildBoundsPipeline(uint32_t workGroupSize) {
+    return buildPipeline("shaders/bounds.comp.spv", { workGroupSize }, *m_mainPipelineLayout);
+}
 
-    vk::SpecializationMapEntry entry0 = {};
-    entry0.constantID = 0;
-    entry0.size = sizeof(uint32_t);
-    entry0.offset = 0;
+void ComputeGenerator::createReducePipeline() {
+    m_reducePipeline = buildReducePipeline(m_workGroupSize, getMainWorkGroupCount(m_size.x * m_size.y));
+}
 
-    vk::SpecializationMapEntry entry1 = {};
-    entry1.constantID = 1;
-    entry1.size = sizeof(uint32_t);
-    entry1.offset = sizeof(uint32_t);
+std::unique_ptr<vk::Pipeline> ComputeGenerator::buildReducePipeline(uint32_t workGroupSize, uint32_t maxWorkGroups) {
+    return buildPipeline("shaders/reduce.comp.spv", { workGroupSize, maxWorkGroups }, *m_mainPipelineLayout);
+}
+
+void ComputeGenerator::createAssignPipelineLayout() {
+    vk::PushConstantRange range = {};
+    range.size = sizeof(AssignPushConstants);
+    range.stageFlags = vk::ShaderStageFlags::Compute;
+
+    vk::PipelineLayoutCreateInfo info = {};
+    info.setLayouts = { *m_descriptorSetLayout };
+    info.pushConstantRanges = { range };
+
+    m_assignPipelineLayout = std::make_unique<vk::PipelineLayout>(m_core->device(), info);
+}
+
+void ComputeGenerator::createAssignPipeline() {
+    m_assignPipeline = buildAssignPipeline(m_workGroupSize);
+}
+
+std::unique_ptr<vk::Pipeline> ComputeGenerator::buildAssignPipeline(uint32_t workGroupSize) {
+    return buildPipeline("shaders/assign.comp.spv", { workGroupSize }, *m_assignPipelineLayout);
+}
+
+std::unique_ptr<vk::Pipeline> ComputeGenerator::buildPipeline(const std::string& path, std::vector<uint32_t> specData, vk::PipelineLayout& layout) {
+    vk::ShaderModule module = loadShader(m_core->device(), path);
+
+    //every shader numbers its specialization constants from 0 in order
+    std::vector<vk::SpecializationMapEntry> entries;
+
+    for (uint32_t i = 0; i < specData.size(); i++) {
+        vk::SpecializationMapEntry entry = {};
+        entry.constantID = i;
+        entry.size = sizeof(uint32_t);
+        entry.offset = i * sizeof(uint32_t);
+        entries.push_back(entry);
+    }
 
     vk::SpecializationInfo specInfo = {};
-    specInfo.dataSize = sizeof(specData);
-    specInfo.data = &specData;
-    specInfo.mapEntries = { entry0, entry1 };
+    specInfo.dataSize = specData.size() * sizeof(uint32_t);
+    specInfo.data = specData.data();
+    specInfo.mapEntries = entries;
 
     vk::PipelineShaderStageCreateInfo shaderInfo = {};
     shaderInfo.module = &module;
@@ -590,20 +1441,34 @@ void ComputeGenerator::createMainPipeline(const std::string& shader) {
 
     vk::ComputePipelineCreateInfo info = {};
     info.stage = shaderInfo;
-    info.layout = m_mainPipelineLayout.get();
+    info.layout = &layout;
 
-    m_mainPipeline = std::make_unique<vk::ComputePipeline>(m_core->device(), info);
+    return std::make_unique<vk::ComputePipeline>(m_core->device(), info, &m_core->pipelineCache());
 }
 
 void ComputeGenerator::createFences() {
+    //a slot is only waited on after it has been submitted
     vk::FenceCreateInfo info = {};
-    info.flags = vk::FenceCreateFlags::Signaled;
 
-    for (size_t i = 0; i < FRAMES; i++) {
+    for (size_t i = 0; i < m_frames; i++) {
         m_fences.emplace_back(m_core->device(), info);
     }
 }
 
 uint32_t ComputeGenerator::getWorkGroupCount(size_t count) {
     return static_cast<uint32_t>(count / m_workGroupSize) + ((count % m_workGroupSize) == 0 ? 0 : 1);
+}
+
+uint32_t ComputeGenerator::getMainWorkGroupCount(size_t count) {
+    return std::min(getWorkGroupCount(count), static_cast<uint32_t>(MAX_MAIN_WORK_GROUPS));
+}
+
+uint32_t ComputeGenerator::getClaimCount() {
+    //a power of two at least twice the candidates, so probing stays short
+    uint32_t count = 1;
+    while (count < 2 * m_batchCapacity * CANDIDATES) {
+        count *= 2;
+    }
+
+    return count;
 }
\ No newline at end of file
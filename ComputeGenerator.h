@@ -4,6 +4,9 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <unordered_set>
 #include <glm/glm.hpp>
 #include "Generator.h"
@@ -15,22 +18,53 @@
 #include "Utilities.h"
 #include "ColorQueue.h"
 #include "Options.h"
+#include "LockFreeQueue.h"
+#include "Profiler.h"
+#include "ColorMetric.h"
 
 class ComputeGenerator : public Generator {
-    struct ColorPos {
+    struct Placement {
         Color32 color;
         glm::ivec2 pos;
+        uint32_t opened;
+        uint32_t open;
     };
 
     struct FrameData {
-        std::unique_ptr<vk::Buffer> positionBuffer;
-        void* positionMapping;
         std::unique_ptr<vk::Buffer> colorBuffer;
         void* colorMapping;
         std::unique_ptr<vk::Buffer> outputBuffer;
-        void* outputMapping;
+        std::unique_ptr<vk::Buffer> boundsBuffer;
+        std::unique_ptr<vk::Buffer> resultBuffer;
+        std::unique_ptr<vk::Buffer> assignmentBuffer;
+        std::unique_ptr<vk::Buffer> claimBuffer;
+        std::unique_ptr<vk::Buffer> readbackBuffer;
+        void* readbackMapping;
+        std::unique_ptr<vk::Buffer> updateBuffer;
+        void* updateMapping;
+        std::vector<Allocation> allocations;
         std::unique_ptr<vk::DescriptorSet> descriptor;
         std::unique_ptr<vk::CommandBuffer> commandBuffer;
+        std::vector<Color32> colors;
+        uint64_t computeValue;
+        std::chrono::steady_clock::time_point submitTime;
+        double gpuTime;
+        double latency;
+        double cpuTime;
+        uint32_t placed;
+        uint32_t rejected;
+        bool complete;
+    };
+
+    struct BatchWindow {
+        std::chrono::steady_clock::time_point start;
+        uint64_t placed;
+        uint64_t dispatched;
+        uint64_t rejected;
+        double gpuTime;
+        double latency;
+        double cpuTime;
+        uint32_t batches;
     };
 
 public:
@@ -39,9 +73,14 @@ public:
     ComputeGenerator& operator = (const ComputeGenerator& other) = delete;
     ComputeGenerator(ComputeGenerator&& other);
     ComputeGenerator& operator = (ComputeGenerator&& other) = default;
+    ~ComputeGenerator();
 
     void run();
     void stop();
+    bool finished() { return *m_finished; }
+
+    vk::Image& texture() { return *m_texture; }
+    Profiler& profiler() { return *m_profiler; }
 
 private:
     Core* m_core;
@@ -53,49 +92,130 @@ private:
     Bitmap m_bitmap;
     std::unique_ptr<vk::Image> m_texture;
     std::unique_ptr<vk::ImageView> m_textureView;
+    std::unique_ptr<vk::Image> m_keyTexture;
+    std::unique_ptr<vk::ImageView> m_keyTextureView;
     std::vector<FrameData> m_frameData;
+    std::unique_ptr<vk::Buffer> m_frontierBuffer;
+    std::unique_ptr<vk::Buffer> m_frontierInfoBuffer;
+    std::unique_ptr<vk::Buffer> m_scratchBuffer;
+    std::unique_ptr<vk::Buffer> m_stateBuffer;
+    std::unique_ptr<vk::Buffer> m_tileBuffer;
+    std::unique_ptr<vk::Buffer> m_tileListBuffer;
+    std::unique_ptr<vk::Buffer> m_sumBuffer;
     std::unique_ptr<vk::DescriptorSetLayout> m_descriptorSetLayout;
     std::unique_ptr<vk::DescriptorPool> m_descriptorPool;
     std::unique_ptr<vk::CommandPool> m_commandPool;
     std::unique_ptr<vk::PipelineLayout> m_updatePipelineLayout;
     std::unique_ptr<vk::Pipeline> m_updatePipeline;
+    std::unique_ptr<vk::PipelineLayout> m_frontierPipelineLayout;
+    std::unique_ptr<vk::Pipeline> m_frontierPipeline;
     std::unique_ptr<vk::PipelineLayout> m_mainPipelineLayout;
     std::unique_ptr<vk::Pipeline> m_mainPipeline;
+    std::unique_ptr<vk::Pipeline> m_boundsPipeline;
+    std::unique_ptr<vk::Pipeline> m_reducePipeline;
+    std::unique_ptr<vk::PipelineLayout> m_assignPipelineLayout;
+    std::unique_ptr<vk::Pipeline> m_assignPipeline;
     std::vector<vk::Fence> m_fences;
-    size_t m_frame = 0;
+    std::vector<Allocation> m_allocations;
+    std::unique_ptr<Profiler> m_profiler;
+    ColorMetric m_metric;
+
+    //owned by the readback thread
+    OpenSet m_openSet;
+    uint32_t m_openedCount = 0;
+    uint64_t m_dispatchedCount = 0;
+    uint64_t m_placedCount = 0;
+
+    //owned by the submit thread
+    std::vector<Placement> m_writes;
+    std::vector<Color32> m_retry;
+    uint32_t m_appliedOpened = 0;
+    uint32_t m_appliedOpen = 0;
+    uint32_t m_compactedCount = 0;
+    uint64_t m_submitted = 0;
+    BatchWindow m_batchWindow = {};
+    uint32_t m_batchLimit;
+    uint32_t m_maxBatchLimit;
+    float m_batchStep = 1.25f;
+    double m_lastThroughput = 0.0;
 
-    std::unordered_set<glm::ivec2> m_openSet;
+    std::unique_ptr<LockFreeQueue<uint32_t>> m_freeSlots;
+    std::unique_ptr<LockFreeQueue<uint32_t>> m_submittedSlots;
+    //wakes the readback thread once a slot is submitted
+    std::unique_ptr<std::mutex> m_submittedMutex;
+    std::unique_ptr<std::condition_variable> m_submittedReady;
+    std::unique_ptr<LockFreeQueue<Placement>> m_placements;
+    std::unique_ptr<LockFreeQueue<Color32>> m_rejected;
+    std::unique_ptr<std::atomic<uint64_t>> m_completed;
+    std::unique_ptr<std::atomic<float>> m_collisionRate;
 
     std::thread m_thread;
+    std::thread m_readbackThread;
     std::unique_ptr<std::atomic_bool> m_running;
-    std::queue<ColorPos> m_queue;
+    std::unique_ptr<std::atomic_bool> m_finished;
+    std::chrono::steady_clock::time_point m_start;
 
+    uint32_t m_frames;
     uint32_t m_workGroupSize;
+    int32_t m_radius;
     uint32_t m_maxBatchAbsolute;
     uint32_t m_maxBatchRelative;
+    uint32_t m_batchCapacity;
+    uint32_t m_updateCapacity;
+    bool m_adaptiveBatch;
+    float m_collisionCeiling;
 
-    void record(vk::CommandBuffer& commandBuffer, std::vector<glm::ivec2>& openList, std::vector<Color32>& colors, size_t index, uint32_t batchSize);
+    void record(vk::CommandBuffer& commandBuffer, size_t index, uint32_t batchSize);
+    void recordFrontier(vk::CommandBuffer& commandBuffer, size_t index, uint32_t mode, uint32_t batchSize);
+    void recordBarrier(vk::CommandBuffer& commandBuffer, vk::AccessFlags dstAccess, vk::PipelineStageFlags dstStage);
     void createCommandPool();
     void createCommandBuffers();
     void createTexture();
     void createTextureView();
-    void createPositionBuffers();
+    void createKeyTexture();
+    std::unique_ptr<vk::Image> createStorageImage(vk::ImageUsageFlags usage, vk::ImageCreateFlags flags);
+    std::unique_ptr<vk::ImageView> createStorageImageView(vk::Image& image);
+    void createFrontierBuffers();
     void createColorBuffers();
     void createOutputBuffers();
+    void createUpdateBuffers();
     void createDescriptorSetLayout();
     void createDescriptorPool();
     void createDescriptorSets();
     void writeDescriptors();
     void createUpdatePipelineLayout();
     void createUpdatePipeline();
+    std::unique_ptr<vk::Pipeline> buildUpdatePipeline(uint32_t workGroupSize, uint32_t radius);
+    void createFrontierPipelineLayout();
+    void createFrontierPipeline();
+    std::unique_ptr<vk::Pipeline> buildFrontierPipeline(uint32_t workGroupSize, uint32_t maxMainGroups);
     void createMainPipelineLayout();
     void createMainPipeline(const std::string& shader);
+    std::unique_ptr<vk::Pipeline> buildMainPipeline(const std::string& shader, uint32_t workGroupSize, uint32_t maxWorkGroups, uint32_t radius);
+    void createBoundsPipeline();
+    std::unique_ptr<vk::Pipeline> buildBoundsPipeline(uint32_t workGroupSize);
+    void createReducePipeline();
+    std::unique_ptr<vk::Pipeline> buildReducePipeline(uint32_t workGroupSize, uint32_t maxWorkGroups);
+    void createAssignPipelineLayout();
+    void createAssignPipeline();
+    std::unique_ptr<vk::Pipeline> buildAssignPipeline(uint32_t workGroupSize);
+    std::unique_ptr<vk::Pipeline> buildPipeline(const std::string& path, std::vector<uint32_t> specData, vk::PipelineLayout& layout);
+    void prewarmPipelines();
     void createFences();
 
     void addToOpenSet(glm::ivec2 pos);
     void addNeighborsToOpenSet(glm::ivec2 pos);
-    void readResult(size_t index, std::vector<glm::ivec2>& openList, std::vector<Color32>& colors);
+    void readResult(size_t index);
+    void drainQueues();
+    uint32_t getBatchSize();
+    void updateBatchLimit(FrameData& frameData);
+    void resizeBatchBuffers(uint32_t capacity);
 
-    void generatorLoop();
+    void submitLoop();
+    void readbackLoop();
+    void pushSubmitted(uint32_t index);
     uint32_t getWorkGroupCount(size_t count);
+    uint32_t getMainWorkGroupCount(size_t count);
+    uint32_t getClaimCount();
+    std::unique_ptr<vk::Buffer> createDeviceBuffer(size_t size, vk::BufferUsageFlags usage);
 };
\ No newline at end of file
@@ -2,21 +2,39 @@
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 CoralGenerator::CoralGenerator(ColorSource& source, ColorQueue& colorQueue, Options& options)
-    : m_bitmap(options.size.x, options.size.y) {
+    : m_bitmap(options.size.x, options.size.y),
+    m_colors(options.metric == Metric::Lab ? options.size.x : 0, options.metric == Metric::Lab ? options.size.y : 0),
+    m_metric(options.metric) {
     m_source = &source;
     m_queue = &colorQueue;
     m_running = std::make_unique<std::atomic_bool>();
+    m_finished = std::make_unique<std::atomic_bool>(false);
+
+    if (options.sampleSize > 0) {
+        m_sampler = std::make_unique<FrontierSampler>(options.sampleSize, options.seed);
+    }
+
+    //the 3x3 ring is cheaper to score directly
+    m_radius = static_cast<int32_t>(options.radius);
+    if (m_radius > 1) {
+        m_sums.resize(m_bitmap.width() * m_bitmap.height());
+    }
 
     glm::ivec2 pos = { static_cast<int>(m_bitmap.width() / 2), static_cast<int>(m_bitmap.height() / 2) };
     if (m_source->hasNext()) {
-        m_bitmap.getPixel(pos.x, pos.y) = m_source->getNext();
+        Color32 color = m_source->getNext();
+        m_queue->enqueue(pos, color);
+        m_bitmap.getPixel(pos.x, pos.y) = m_metric.getKey(color);
+        setColor(pos, color);
+        addToSums(pos, m_bitmap.getPixel(pos.x, pos.y));
         addNeighborsToOpenSet(pos);
     }
 }
 
-CoralGenerator::CoralGenerator(CoralGenerator&& other) : m_bitmap(std::move(other.m_bitmap)) {
+CoralGenerator::CoralGenerator(CoralGenerator&& other) : m_bitmap(std::move(other.m_bitmap)), m_colors(std::move(other.m_colors)), m_metric(other.m_metric) {
     *this = std::move(other);
 }
 
@@ -39,12 +57,17 @@ void CoralGenerator::mainLoop() {
         if (!m_source->hasNext()) break;
         if (m_openSet.size() == 0) break;
 
-        m_openList.clear();
-        for (auto pos : m_openSet) {
-            m_openList.push_back(pos);
+        if (m_sampler != nullptr) {
+            m_sampler->sample(m_openList);
+        } else {
+            m_openList.clear();
+            for (auto pos : m_openSet) {
+                m_openList.push_back(pos);
+            }
         }
 
         m_color = m_source->getNext();
+        m_key = m_metric.getKey(m_color);
 
         size_t result = score();
         readResult(result);
@@ -57,19 +80,42 @@ void CoralGenerator::mainLoop() {
     auto elapsed = std::chrono::duration<double>(end - start).count();
     size_t totalPixels = m_queue->totalCount();
     size_t rate = (size_t)(totalPixels / elapsed);
+    //measured on the display colors, so runs with different metrics compare on the same scale
+    double quality = ColorMetric::neighborDistance(m_colors.width() > 0 ? m_colors : m_bitmap);
+
+    std::lock_guard<std::mutex> lock(outputMutex());
     if (elapsed < 10.0) {
         std::cout << std::setprecision(1) << std::fixed;
     } else {
         std::cout << std::setprecision(0) << std::fixed;
     }
     std::cout << totalPixels << " in " << elapsed << "s (" << rate << " pps)\n";
+    std::cout << std::setprecision(2) << "Quality: " << quality << " average neighbor distance\n";
+    *m_finished = true;
 }
 
 size_t CoralGenerator::score() {
     size_t result;
     int32_t bestScore = std::numeric_limits<int32_t>::max();
+    glm::ivec3 testColor = { m_key.r, m_key.g, m_key.b };
+
     for (size_t i = 0; i < m_openList.size(); i++) {
         glm::ivec2 pos = m_openList[i];
+
+        if (m_radius > 1) {
+            //sum of |c - n|^2 over the window, expanded so only the totals are needed
+            auto& sums = m_sums[pos.x + pos.y * m_bitmap.width()];
+            int32_t dot = testColor.r * sums.r + testColor.g * sums.g + testColor.b * sums.b;
+            int32_t sum = sums.count * length2(testColor) - 2 * dot + sums.squares;
+
+            int32_t score = static_cast<int32_t>(sum / static_cast<float>(sums.count));
+            if (score < bestScore) {
+                result = i;
+                bestScore = score;
+            }
+            continue;
+        }
+
         glm::ivec2 neighbors[8] = {
             pos + glm::ivec2{ -1, -1 },
             pos + glm::ivec2{ -1,  0 },
@@ -81,8 +127,6 @@ size_t CoralGenerator::score() {
             pos + glm::ivec2{ 1,  1 },
         };
 
-        glm::ivec3 testColor = { m_color.r, m_color.g, m_color.b };
-
         int32_t count = 0;
         int32_t sum = 0;
 
@@ -105,19 +149,59 @@ size_t CoralGenerator::score() {
         }
     }
 
+    m_score = bestScore;
     return result;
 }
 
+void CoralGenerator::setColor(glm::ivec2 pos, Color32 color) {
+    if (m_colors.width() > 0) {
+        m_colors.getPixel(pos.x, pos.y) = color;
+    }
+}
+
 void CoralGenerator::readResult(size_t result) {
     glm::ivec2 pos = m_openList[result];
     m_queue->enqueue(pos, m_color);
-    m_bitmap.getPixel(pos.x, pos.y) = m_color;
+    //the bitmap only feeds scoring, so it holds keys rather than display colors
+    m_bitmap.getPixel(pos.x, pos.y) = m_key;
+    setColor(pos, m_color);
+    addToSums(pos, m_key);
     addNeighborsToOpenSet(pos);
     m_openSet.erase(pos);
+
+    if (m_sampler != nullptr) {
+        m_sampler->remove(pos);
+        m_sampler->place(pos, m_score);
+    }
+}
+
+void CoralGenerator::addToSums(glm::ivec2 pos, Color32 key) {
+    if (m_radius <= 1) return;
+
+    int32_t width = static_cast<int32_t>(m_bitmap.width());
+    int32_t height = static_cast<int32_t>(m_bitmap.height());
+    int32_t squares = key.r * key.r + key.g * key.g + key.b * key.b;
+
+    for (int32_t y = std::max(pos.y - m_radius, 0); y <= std::min(pos.y + m_radius, height - 1); y++) {
+        for (int32_t x = std::max(pos.x - m_radius, 0); x <= std::min(pos.x + m_radius, width - 1); x++) {
+            if (x == pos.x && y == pos.y) continue;
+
+            auto& sums = m_sums[x + y * width];
+            sums.count++;
+            sums.r += key.r;
+            sums.g += key.g;
+            sums.b += key.b;
+            sums.squares += squares;
+        }
+    }
 }
 
 void CoralGenerator::addToOpenSet(glm::ivec2 pos) {
     m_openSet.insert(pos);
+
+    if (m_sampler != nullptr) {
+        m_sampler->add(pos);
+    }
 }
 
 void CoralGenerator::addNeighborsToOpenSet(glm::ivec2 pos) {
@@ -11,8 +11,19 @@
 #include "Utilities.h"
 #include "ColorQueue.h"
 #include "Options.h"
+#include "ColorMetric.h"
+#include "FrontierSampler.h"
 
 class CoralGenerator : public Generator {
+    //totals over the filled pixels around a pixel, so a score costs the same for any radius
+    struct NeighborSums {
+        int32_t count;
+        int32_t r;
+        int32_t g;
+        int32_t b;
+        int32_t squares;
+    };
+
 public:
     CoralGenerator(ColorSource& source, ColorQueue& colorQueue, Options& options);
     CoralGenerator(const CoralGenerator& other) = delete;
@@ -22,21 +33,33 @@ public:
 
     void run();
     void stop();
+    bool finished() { return *m_finished; }
 
 private:
     ColorSource * m_source;
     Bitmap m_bitmap;
+    //display colors for the quality metric, only kept when the keys are not the colors themselves
+    Bitmap m_colors;
     ColorQueue* m_queue;
+    ColorMetric m_metric;
     std::thread m_mainThread;
     std::unique_ptr<std::atomic_bool> m_running;
-    std::unordered_set<glm::ivec2> m_openSet;
-    std::vector<glm::ivec2> m_openList;
+    std::unique_ptr<std::atomic_bool> m_finished;
+    OpenSet m_openSet;
+    OpenList m_openList;
     Color32 m_color;
+    Color32 m_key;
+    int32_t m_score;
+    std::unique_ptr<FrontierSampler> m_sampler;
+    int32_t m_radius;
+    std::vector<NeighborSums, TrackingAllocator<NeighborSums, MemoryCategory::NeighborSums>> m_sums;
 
     void mainLoop();
 
     void addToOpenSet(glm::ivec2 pos);
     void addNeighborsToOpenSet(glm::ivec2 pos);
+    void addToSums(glm::ivec2 pos, Color32 key);
     size_t score();
+    void setColor(glm::ivec2 pos, Color32 color);
     void readResult(size_t);
 };
\ No newline at end of file
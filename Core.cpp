@@ -1,6 +1,15 @@
 #include "Core.h"
 #include <set>
 #include <iostream>
+#include <limits>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include "Utilities.h"
+
+#define NO_FRAME std::numeric_limits<uint64_t>::max()
 
 const std::vector<std::string> validationLayers = {
 #ifndef NDEBUG
@@ -12,23 +21,41 @@ const std::vector<std::string> deviceExtensions = {
     "VK_KHR_swapchain"
 };
 
+const std::string timelineExtension = "VK_KHR_timeline_semaphore";
+const std::string memoryBudgetExtension = "VK_EXT_memory_budget";
+
 Core::Core(GLFWwindow* window) {
+    //without a window there is no surface or swapchain, only a device for the compute generators
     m_window = window;
 
     createInstance();
-    createSurface();
+    if (!headless()) createSurface();
     selectPhysicalDevice();
+    querySubgroupSupport();
+    queryTimelineSupport();
+    queryMemoryBudgetSupport();
     createDevice();
     createCommandPool();
-    recreateSwapchain();
+    createPipelineCache();
+    if (!headless()) recreateSwapchain();
     createSemaphores();
     preSignalComputeSemaphore();
 
-    glfwSetWindowUserPointer(window, this);
-    glfwSetWindowSizeCallback(window, &ResizeWindow);
-    ResizeWindow(window, 0, 0);
+    if (!headless()) {
+        glfwSetWindowUserPointer(window, this);
+        glfwSetWindowSizeCallback(window, &ResizeWindow);
+        glfwSetWindowRefreshCallback(window, &RefreshWindow);
+        glfwSetScrollCallback(window, &ScrollWindow);
+        glfwSetCursorPosCallback(window, &MoveCursor);
+        glfwSetMouseButtonCallback(window, &PressMouse);
+        ResizeWindow(window, 0, 0);
+    }
+
     resizeFlag = false;
     m_queueMutex = std::make_unique<std::mutex>();
+    m_syncMutex = std::make_unique<std::mutex>();
+    m_computeValue = std::make_unique<std::atomic<uint64_t>>(0);
+    m_renderValue = std::make_unique<std::atomic<uint64_t>>(0);
 }
 
 Core::Core(Core&& other) {
@@ -46,6 +73,44 @@ void Core::ResizeWindow(GLFWwindow* window, int width, int height) {
     core->resizeFlag = true;
 }
 
+void Core::RefreshWindow(GLFWwindow* window) {
+    Core* core = reinterpret_cast<Core*>(glfwGetWindowUserPointer(window));
+    core->m_refreshFlag = true;
+}
+
+void Core::ScrollWindow(GLFWwindow* window, double x, double y) {
+    Core* core = reinterpret_cast<Core*>(glfwGetWindowUserPointer(window));
+
+    for (auto observer : core->m_observers) {
+        observer->onScroll(y, core->m_cursorX, core->m_cursorY);
+    }
+
+    core->m_refreshFlag = true;
+}
+
+void Core::MoveCursor(GLFWwindow* window, double x, double y) {
+    Core* core = reinterpret_cast<Core*>(glfwGetWindowUserPointer(window));
+
+    if (core->m_dragging) {
+        for (auto observer : core->m_observers) {
+            observer->onDrag(x - core->m_cursorX, y - core->m_cursorY);
+        }
+
+        core->m_refreshFlag = true;
+    }
+
+    core->m_cursorX = x;
+    core->m_cursorY = y;
+}
+
+void Core::PressMouse(GLFWwindow* window, int button, int action, int mods) {
+    Core* core = reinterpret_cast<Core*>(glfwGetWindowUserPointer(window));
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT) {
+        core->m_dragging = action == GLFW_PRESS;
+    }
+}
+
 void Core::registerObserver(Observer* observer) {
     m_observers.push_back(observer);
 }
@@ -61,10 +126,26 @@ void Core::acquire() {
         }
     }
 
+    m_refreshFlag = false;
     m_swapchain->acquireNextImage(~0, m_acquireSem.get(), nullptr, m_imageIndex);
     m_commandBuffer = &m_commandBuffers[m_imageIndex];
-    m_fences[m_imageIndex].wait();
-    m_fences[m_imageIndex].reset();
+
+    {
+        //the compute thread may be waiting on this fence for an unpaired render
+        std::unique_lock<std::mutex> syncLock;
+
+        if (m_computeSync && !m_timelineSupported) {
+            syncLock = std::unique_lock<std::mutex>(*m_syncMutex);
+        }
+
+        m_fences[m_imageIndex].wait();
+        m_fences[m_imageIndex].reset();
+        m_fenceFrames[m_imageIndex] = NO_FRAME;
+
+        if (m_unpairedFence == &m_fences[m_imageIndex]) {
+            m_unpairedFence = nullptr;
+        }
+    }
 
     m_commandBuffer->reset(vk::CommandBufferResetFlags::None);
 
@@ -81,12 +162,58 @@ vk::CommandBuffer& Core::getCommandBuffer() {
 void Core::present() {
     m_commandBuffer->end();
 
+    if (m_timelineSupported) {
+        submitRenderTimeline();
+    } else {
+        submitRender();
+    }
+
+    m_fenceFrames[m_imageIndex] = m_frameCount;
+    m_frameCount++;
+
+    vk::PresentInfo presentInfo = {};
+    presentInfo.imageIndices = { m_imageIndex };
+    presentInfo.swapchains = { *m_swapchain };
+    presentInfo.waitSemaphores = { *m_RenderSem };
+
+    m_presentQueue->present(presentInfo);
+}
+
+void Core::submitRender() {
     vk::SubmitInfo submitInfo = {};
     submitInfo.commandBuffers = { *m_commandBuffer };
     submitInfo.waitSemaphores = { *m_acquireSem };
     submitInfo.waitDstStageMask = { vk::PipelineStageFlags::ColorAttachmentOutput };
     submitInfo.signalSemaphores = { *m_RenderSem };
 
+    std::unique_lock<std::mutex> syncLock;
+
+    if (m_computeSync) {
+        //the renderer samples the compute image, so hand it back and forth with the compute queue
+        syncLock = std::unique_lock<std::mutex>(*m_syncMutex);
+
+        if (m_computeSignalPending) {
+            submitInfo.waitSemaphores.push_back(*m_computeRenderSem);
+            submitInfo.waitDstStageMask.push_back(vk::PipelineStageFlags::FragmentShader);
+            m_computeSignalPending = false;
+        }
+
+        if (m_computeUnpaired) {
+            //batches queued after the signaled one had no semaphore left, so wait for them here
+            std::lock_guard<std::mutex> lock(*m_queueMutex);
+            m_computeQueue->waitIdle();
+            m_computeUnpaired = false;
+        }
+
+        if (!m_renderSignalPending) {
+            submitInfo.signalSemaphores.push_back(*m_renderComputeSem);
+            m_renderSignalPending = true;
+        } else {
+            //the next compute batch waits on this frame's fence instead
+            m_unpairedFence = &m_fences[m_imageIndex];
+        }
+    }
+
     if (m_sharedQueue) {
         std::lock_guard<std::mutex> lock(*m_queueMutex);
         m_graphicsQueue->submit({ submitInfo }, &m_fences[m_imageIndex]);
@@ -94,12 +221,60 @@ void Core::present() {
         m_graphicsQueue->submit({ submitInfo }, &m_fences[m_imageIndex]);
     }
 
-    vk::PresentInfo presentInfo = {};
-    presentInfo.imageIndices = { m_imageIndex };
-    presentInfo.swapchains = { *m_swapchain };
-    presentInfo.waitSemaphores = { *m_RenderSem };
+    if (syncLock.owns_lock()) {
+        syncLock.unlock();
+    }
+}
 
-    m_presentQueue->present(presentInfo);
+void Core::submitRenderTimeline() {
+    TimelineSubmit submit = {};
+    submit.waitSemaphores = { m_acquireSem->handle() };
+    submit.waitValues = { 0 };
+    submit.waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    submit.signalSemaphores = { m_RenderSem->handle() };
+    submit.signalValues = { 0 };
+
+    uint64_t renderValue = 0;
+    std::unique_lock<std::mutex> syncLock;
+
+    if (m_computeSync) {
+        //reading one value and publishing the other under the same lock orders every render against every compute batch
+        syncLock = std::unique_lock<std::mutex>(*m_syncMutex);
+
+        //sample the image only once the latest compute batch has written it
+        submit.waitSemaphores.push_back(m_computeTimeline->handle());
+        submit.waitValues.push_back(m_computeValue->load());
+        submit.waitStages.push_back(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        renderValue = m_renderValue->load() + 1;
+        submit.signalSemaphores.push_back(m_renderTimeline->handle());
+        submit.signalValues.push_back(renderValue);
+    }
+
+    if (m_sharedQueue) {
+        std::lock_guard<std::mutex> lock(*m_queueMutex);
+        submitTimeline(*m_graphicsQueue, *m_commandBuffer, submit, &m_fences[m_imageIndex]);
+    } else {
+        submitTimeline(*m_graphicsQueue, *m_commandBuffer, submit, &m_fences[m_imageIndex]);
+    }
+
+    //published after the submit, so the compute queue never waits on a value that is not queued yet
+    if (m_computeSync) {
+        m_renderValue->store(renderValue);
+    }
+}
+
+bool Core::isFrameComplete(uint64_t frame) {
+    if (frame >= m_frameCount) return false;
+
+    for (size_t i = 0; i < m_fences.size(); i++) {
+        if (m_fenceFrames[i] == frame) {
+            return vkGetFenceStatus(m_device->handle(), m_fences[i].handle()) == VK_SUCCESS;
+        }
+    }
+
+    //the fence has been waited on and reused since this frame was submitted
+    return true;
 }
 
 vk::CommandBuffer Core::getSingleUseCommandBuffer() {
@@ -132,32 +307,135 @@ void Core::submitSingleUseCommandBuffer(vk::CommandBuffer&& commandBuffer) {
     m_graphicsQueue->waitIdle();
 }
 
-void Core::submitCompute(vk::CommandBuffer& commandBuffer, vk::Fence* fence) {
+uint64_t Core::submitCompute(vk::CommandBuffer& commandBuffer, vk::Fence* fence) {
+    if (m_timelineSupported) {
+        return submitComputeTimeline(commandBuffer, fence);
+    }
+
     vk::SubmitInfo info = {};
     info.commandBuffers = { commandBuffer };
     info.waitSemaphores = { *m_computeSemaphore };
     info.waitDstStageMask = { vk::PipelineStageFlags::ComputeShader };
     info.signalSemaphores = { *m_computeSemaphore };
+
+    std::unique_lock<std::mutex> syncLock;
+
+    if (m_computeSync) {
+        syncLock = std::unique_lock<std::mutex>(*m_syncMutex);
+
+        if (m_renderSignalPending) {
+            info.waitSemaphores.push_back(*m_renderComputeSem);
+            info.waitDstStageMask.push_back(vk::PipelineStageFlags::ComputeShader);
+            m_renderSignalPending = false;
+        }
+
+        if (m_unpairedFence != nullptr) {
+            //a later render still samples the image without a semaphore to wait on
+            m_unpairedFence->wait();
+            m_unpairedFence = nullptr;
+        }
+
+        if (!m_computeSignalPending) {
+            info.signalSemaphores.push_back(*m_computeRenderSem);
+            m_computeSignalPending = true;
+        } else {
+            m_computeUnpaired = true;
+        }
+    }
     
-    if (m_sharedQueue) {
-        std::lock_guard<std::mutex> lock(*m_queueMutex);
-        m_computeQueue->submit({ info }, fence);
-    } else {
-        m_computeQueue->submit({ info }, fence);
+    //several generators can submit from their own threads
+    std::lock_guard<std::mutex> lock(*m_queueMutex);
+    m_computeQueue->submit({ info }, fence);
+
+    return 0;
+}
+
+uint64_t Core::submitComputeTimeline(vk::CommandBuffer& commandBuffer, vk::Fence* fence) {
+    //a render that read the old render value but has not published its own yet would overlap this batch
+    std::unique_lock<std::mutex> syncLock;
+
+    if (m_computeSync) {
+        syncLock = std::unique_lock<std::mutex>(*m_syncMutex);
     }
+
+    //values must reach the queue in increasing order, even with several generators submitting
+    std::lock_guard<std::mutex> lock(*m_queueMutex);
+
+    //batches on the compute queue are ordered by their own barriers, so only the renderer is waited on
+    uint64_t computeValue = m_computeValue->load() + 1;
+
+    TimelineSubmit submit = {};
+    submit.signalSemaphores = { m_computeTimeline->handle() };
+    submit.signalValues = { computeValue };
+
+    if (m_computeSync) {
+        submit.waitSemaphores.push_back(m_renderTimeline->handle());
+        submit.waitValues.push_back(m_renderValue->load());
+        submit.waitStages.push_back(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    submitTimeline(*m_computeQueue, commandBuffer, submit, fence);
+
+    m_computeValue->store(computeValue);
+    return computeValue;
+}
+
+void Core::waitCompute(uint64_t value) {
+    m_computeTimeline->wait(value);
+}
+
+void Core::submitTimeline(const vk::Queue& queue, vk::CommandBuffer& commandBuffer, const TimelineSubmit& submit, vk::Fence* fence) {
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(submit.waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = submit.waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(submit.signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = submit.signalValues.data();
+
+    VkCommandBuffer commandBufferHandle = commandBuffer.handle();
+
+    VkSubmitInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    info.pNext = &timelineInfo;
+    info.waitSemaphoreCount = static_cast<uint32_t>(submit.waitSemaphores.size());
+    info.pWaitSemaphores = submit.waitSemaphores.data();
+    info.pWaitDstStageMask = submit.waitStages.data();
+    info.commandBufferCount = 1;
+    info.pCommandBuffers = &commandBufferHandle;
+    info.signalSemaphoreCount = static_cast<uint32_t>(submit.signalSemaphores.size());
+    info.pSignalSemaphores = submit.signalSemaphores.data();
+
+    VKW_CHECK(vkQueueSubmit(queue.handle(), 1, &info, fence != nullptr ? fence->handle() : VK_NULL_HANDLE));
+}
+
+void Core::enableComputeSync() {
+    m_computeSync = true;
 }
 
 void Core::createInstance() {
     vk::ApplicationInfo appInfo = {};
     appInfo.applicationName = "VkColors";
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
 
-    uint32_t extensionCount;
-    const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
+    //subgroup operations need 1.1, but a 1.0 loader must still work
+    auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+    if (enumerateInstanceVersion != nullptr) {
+        uint32_t version;
+        if (enumerateInstanceVersion(&version) == VK_SUCCESS && version >= VK_API_VERSION_1_1) {
+            m_apiVersion = VK_API_VERSION_1_1;
+        }
+    }
+
+    appInfo.apiVersion = m_apiVersion;
+
     std::vector<std::string> extensions;
-    for (uint32_t i = 0; i < extensionCount; i++) {
-        extensions.push_back(requiredExtensions[i]);
+
+    if (!headless()) {
+        uint32_t extensionCount;
+        const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
+        for (uint32_t i = 0; i < extensionCount; i++) {
+            extensions.push_back(requiredExtensions[i]);
+        }
     }
 
     vk::InstanceCreateInfo info = {};
@@ -189,6 +467,7 @@ bool Core::checkSwapchainSupport(const vk::PhysicalDevice& physicalDevice) {
 }
 
 bool Core::isDeviceSuitable(const vk::PhysicalDevice& physicalDevice) {
+    if (headless()) return isComputeDeviceSuitable(physicalDevice);
     if (!checkSwapchainSupport(physicalDevice)) return false;
 
     bool graphicsFound = false;
@@ -225,6 +504,22 @@ bool Core::isDeviceSuitable(const vk::PhysicalDevice& physicalDevice) {
     return graphicsFound && presentFound;
 }
 
+bool Core::isComputeDeviceSuitable(const vk::PhysicalDevice& physicalDevice) {
+    //one queue does everything, so every submit goes to the same family
+    auto& families = physicalDevice.queueFamilies();
+    for (uint32_t i = 0; i < families.size(); i++) {
+        auto& queueFamily = families[i];
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & vk::QueueFlags::Compute) != vk::QueueFlags::None) {
+            m_graphicsQueueIndex = i;
+            m_computeQueueIndex = i;
+            m_presentQueueIndex = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void Core::selectPhysicalDevice() {
     auto& physicalDevices = m_instance->physicalDevices();
     std::vector<const vk::PhysicalDevice*> candidates;
@@ -252,6 +547,83 @@ void Core::selectPhysicalDevice() {
     }
 
     m_physicalDevice = candidates[0];
+
+    //queue indices are left over from the last device checked, so find them again for the chosen one
+    isDeviceSuitable(*m_physicalDevice);
+}
+
+void Core::querySubgroupSupport() {
+    m_subgroupArithmetic = false;
+    if (m_apiVersion < VK_API_VERSION_1_1) return;
+    if (m_physicalDevice->properties().apiVersion < VK_API_VERSION_1_1) return;
+
+    auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(vkGetInstanceProcAddr(m_instance->handle(), "vkGetPhysicalDeviceProperties2"));
+    if (getProperties2 == nullptr) return;
+
+    VkPhysicalDeviceSubgroupProperties subgroupProperties = {};
+    subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroupProperties;
+
+    getProperties2(m_physicalDevice->handle(), &properties);
+
+    VkSubgroupFeatureFlags required = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    m_subgroupArithmetic = (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0
+        && (subgroupProperties.supportedOperations & required) == required;
+}
+
+void Core::queryTimelineSupport() {
+    m_timelineSupported = false;
+    if (m_apiVersion < VK_API_VERSION_1_1) return;
+
+    auto& available = m_physicalDevice->availableExtensions();
+    bool found = std::any_of(available.begin(), available.end(),
+        [](auto& extension) { return timelineExtension == extension.extensionName; });
+    if (!found) return;
+
+    auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(vkGetInstanceProcAddr(m_instance->handle(), "vkGetPhysicalDeviceFeatures2"));
+    if (getFeatures2 == nullptr) return;
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+
+    getFeatures2(m_physicalDevice->handle(), &features);
+
+    m_timelineSupported = timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+void Core::queryMemoryBudgetSupport() {
+    m_memoryBudgetSupported = false;
+    if (m_apiVersion < VK_API_VERSION_1_1) return;
+
+    auto& available = m_physicalDevice->availableExtensions();
+    bool found = std::any_of(available.begin(), available.end(),
+        [](auto& extension) { return memoryBudgetExtension == extension.extensionName; });
+    if (!found) return;
+
+    m_getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2>(vkGetInstanceProcAddr(m_instance->handle(), "vkGetPhysicalDeviceMemoryProperties2"));
+    m_memoryBudgetSupported = m_getMemoryProperties2 != nullptr;
+}
+
+void Core::getMemoryBudget(std::vector<size_t>& budget, std::vector<size_t>& usage) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budgetProperties;
+
+    m_getMemoryProperties2(m_physicalDevice->handle(), &properties);
+
+    uint32_t heapCount = properties.memoryProperties.memoryHeapCount;
+    budget.assign(budgetProperties.heapBudget, budgetProperties.heapBudget + heapCount);
+    usage.assign(budgetProperties.heapUsage, budgetProperties.heapUsage + heapCount);
 }
 
 void Core::createDevice() {
@@ -284,10 +656,26 @@ void Core::createDevice() {
 
     vk::PhysicalDeviceFeatures deviceFeatures = {};
 
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+
     vk::DeviceCreateInfo info = {};
     info.queueCreateInfos = queueInfos;
     info.enabledFeatures = &deviceFeatures;
-    info.enabledExtensionNames = deviceExtensions;
+
+    if (!headless()) {
+        info.enabledExtensionNames = deviceExtensions;
+    }
+
+    if (m_timelineSupported) {
+        info.enabledExtensionNames.push_back(timelineExtension);
+        info.next = &timelineFeatures;
+    }
+
+    if (m_memoryBudgetSupported) {
+        info.enabledExtensionNames.push_back(memoryBudgetExtension);
+    }
 
     m_device = std::make_unique<vk::Device>(*m_physicalDevice, info);
 
@@ -304,6 +692,90 @@ void Core::createCommandPool() {
     m_commandPool = std::make_unique<vk::CommandPool>(*m_device, info);
 }
 
+void Core::createPipelineCache() {
+    auto& properties = m_physicalDevice->properties();
+
+    //the driver's cache UUID changes with every driver build, so old files are never picked up
+    std::stringstream builder;
+    builder << std::hex << std::setfill('0');
+    builder << "pipelines-" << std::setw(4) << properties.vendorID << "-" << std::setw(4) << properties.deviceID << "-";
+
+    for (size_t i = 0; i < VK_UUID_SIZE; i++) {
+        builder << std::setw(2) << static_cast<uint32_t>(properties.pipelineCacheUUID[i]);
+    }
+
+    builder << ".cache";
+    m_pipelineCachePath = builder.str();
+
+    std::vector<char> data;
+    try {
+        data = loadFile(m_pipelineCachePath);
+    }
+    catch (...) {
+        //no cache yet, start empty
+    }
+
+    if (!data.empty() && !validatePipelineCache(data)) {
+        std::cout << "Pipeline cache: ignoring invalid " << m_pipelineCachePath << "\n";
+        data.clear();
+    }
+
+    vk::PipelineCacheCreateInfo info = {};
+    info.initialData = std::move(data);
+
+    m_pipelineCache = std::make_unique<vk::PipelineCache>(*m_device, info);
+}
+
+bool Core::validatePipelineCache(const std::vector<char>& data) {
+    //VkPipelineCacheHeaderVersionOne, read field by field since the file may be truncated or from another device
+    struct Header {
+        uint32_t headerSize;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t uuid[VK_UUID_SIZE];
+    };
+
+    if (data.size() < sizeof(Header)) return false;
+
+    Header header;
+    memcpy(&header, data.data(), sizeof(Header));
+
+    auto& properties = m_physicalDevice->properties();
+
+    if (header.headerSize < sizeof(Header) || header.headerSize > data.size()) return false;
+    if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return false;
+    if (header.vendorID != properties.vendorID) return false;
+    if (header.deviceID != properties.deviceID) return false;
+
+    for (size_t i = 0; i < VK_UUID_SIZE; i++) {
+        if (header.uuid[i] != properties.pipelineCacheUUID[i]) return false;
+    }
+
+    return true;
+}
+
+void Core::savePipelineCache() {
+    std::vector<char> data = m_pipelineCache->getData();
+    if (data.empty()) return;
+
+    //write next to the old file and swap, so a crash never leaves a half written cache
+    std::string tempPath = m_pipelineCachePath + ".tmp";
+
+    try {
+        saveFile(tempPath, data);
+    }
+    catch (...) {
+        std::cout << "Pipeline cache: could not write " << tempPath << "\n";
+        return;
+    }
+
+    std::remove(m_pipelineCachePath.c_str());
+    if (std::rename(tempPath.c_str(), m_pipelineCachePath.c_str()) != 0) {
+        std::cout << "Pipeline cache: could not replace " << m_pipelineCachePath << "\n";
+    }
+}
+
 void Core::recreateSwapchain() {
     createSwapchain();
     createImageViews();
@@ -481,6 +953,8 @@ void Core::createFences() {
 
         m_fences.emplace_back(*m_device, info);
     }
+
+    m_fenceFrames.assign(m_fences.size(), NO_FRAME);
 }
 
 void Core::createSemaphores() {
@@ -489,9 +963,19 @@ void Core::createSemaphores() {
     m_acquireSem = std::make_unique<vk::Semaphore>(*m_device, info);
     m_RenderSem = std::make_unique<vk::Semaphore>(*m_device, info);
     m_computeSemaphore = std::make_unique<vk::Semaphore> (*m_device, info);
+    m_computeRenderSem = std::make_unique<vk::Semaphore>(*m_device, info);
+    m_renderComputeSem = std::make_unique<vk::Semaphore>(*m_device, info);
+
+    if (m_timelineSupported) {
+        m_computeTimeline = std::make_unique<TimelineSemaphore>(*m_device, 0);
+        m_renderTimeline = std::make_unique<TimelineSemaphore>(*m_device, 0);
+    }
 }
 
 void Core::preSignalComputeSemaphore() {
+    //the binary chain is only used when timeline semaphores are missing
+    if (m_timelineSupported) return;
+
     vk::SubmitInfo info = {};
     info.signalSemaphores = { *m_computeSemaphore };
 
@@ -3,10 +3,16 @@
 #include <GLFW/glfw3.h>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <string>
+#include "TimelineSemaphore.h"
 
 class Observer {
 public:
     virtual void onResize(int width, int height) = 0;
+    //cursor positions are in window coordinates
+    virtual void onScroll(double offset, double x, double y) {}
+    virtual void onDrag(double dx, double dy) {}
 };
 
 class Core {
@@ -17,7 +23,12 @@ public:
     Core(Core&& other);
     Core& operator = (Core&& other) = default;
 
+    bool headless() { return m_window == nullptr; }
     uint32_t imageIndex() { return m_imageIndex; }
+    uint64_t frameNumber() { return m_frameCount; }
+    bool isFrameComplete(uint64_t frame);
+    //the window was resized or uncovered, so the last presented image is stale
+    bool needsRedraw() { return resizeFlag || m_refreshFlag; }
     void acquire();
     vk::CommandBuffer& getCommandBuffer();
     void present();
@@ -25,22 +36,51 @@ public:
     void submitSingleUseCommandBuffer(vk::CommandBuffer&& commandBuffer);
     void beginRenderPass(vk::CommandBuffer& commandBuffer);
 
-    void submitCompute(vk::CommandBuffer& commandBuffer, vk::Fence* fence);
+    uint64_t submitCompute(vk::CommandBuffer& commandBuffer, vk::Fence* fence);
+    void waitCompute(uint64_t value);
+    void enableComputeSync();
 
     void registerObserver(Observer* observer);
 
     vk::Device& device() { return *m_device; }
     vk::Swapchain& swapchain() { return *m_swapchain; }
     vk::RenderPass& renderPass() { return *m_renderPass; }
+    vk::PipelineCache& pipelineCache() { return *m_pipelineCache; }
+    void savePipelineCache();
 
+    uint32_t graphicsQueueFamilyIndex() { return m_graphicsQueueIndex; }
     uint32_t computeQueueFamilyIndex() { return m_computeQueueIndex; }
+    bool subgroupArithmetic() { return m_subgroupArithmetic; }
+    bool timelineSemaphores() { return m_timelineSupported; }
+    bool memoryBudget() { return m_memoryBudgetSupported; }
+    void getMemoryBudget(std::vector<size_t>& budget, std::vector<size_t>& usage);
+    uint32_t imageCount() { return m_swapchain == nullptr ? 0 : static_cast<uint32_t>(m_swapchain->images().size()); }
+    float timestampPeriod() { return m_physicalDevice->properties().limits.timestampPeriod; }
+    uint32_t timestampValidBits(uint32_t queueFamilyIndex) { return m_physicalDevice->queueFamilies()[queueFamilyIndex].timestampValidBits; }
 
 private:
-    GLFWwindow* m_window;
+    struct TimelineSubmit {
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<uint64_t> waitValues;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<VkSemaphore> signalSemaphores;
+        std::vector<uint64_t> signalValues;
+    };
+
+    GLFWwindow* m_window = nullptr;
     int m_width;
     int m_height;
     bool resizeFlag = false;
+    bool m_refreshFlag = false;
+    bool m_dragging = false;
+    double m_cursorX = 0;
+    double m_cursorY = 0;
     bool m_sharedQueue;
+    uint32_t m_apiVersion = VK_API_VERSION_1_0;
+    bool m_subgroupArithmetic = false;
+    bool m_timelineSupported = false;
+    bool m_memoryBudgetSupported = false;
+    PFN_vkGetPhysicalDeviceMemoryProperties2 m_getMemoryProperties2 = nullptr;
     std::vector<Observer*> m_observers;
     std::unique_ptr<vk::Instance> m_instance;
     const vk::PhysicalDevice* m_physicalDevice = nullptr;
@@ -53,29 +93,55 @@ private:
     const vk::Queue* m_computeQueue;
     const vk::Queue* m_presentQueue;
     std::unique_ptr<vk::CommandPool> m_commandPool;
+    std::string m_pipelineCachePath;
+    std::unique_ptr<vk::PipelineCache> m_pipelineCache;
     std::unique_ptr<vk::Swapchain> m_swapchain;
     std::vector<vk::ImageView> m_swapchainImageViews;
     std::unique_ptr<vk::RenderPass> m_renderPass;
     std::vector<vk::Framebuffer> m_framebuffers;
     std::vector<vk::CommandBuffer> m_commandBuffers;
     std::vector<vk::Fence> m_fences;
+    std::vector<uint64_t> m_fenceFrames;
     std::unique_ptr<vk::Semaphore> m_acquireSem;
     std::unique_ptr<vk::Semaphore> m_RenderSem;
     std::unique_ptr<std::mutex> m_queueMutex;
     std::unique_ptr<vk::Semaphore> m_computeSemaphore;
+    std::unique_ptr<std::mutex> m_syncMutex;
+    std::unique_ptr<vk::Semaphore> m_computeRenderSem;
+    std::unique_ptr<vk::Semaphore> m_renderComputeSem;
+    bool m_computeSync = false;
+    bool m_computeSignalPending = false;
+    bool m_renderSignalPending = false;
+    bool m_computeUnpaired = false;
+    vk::Fence* m_unpairedFence = nullptr;
+    std::unique_ptr<TimelineSemaphore> m_computeTimeline;
+    std::unique_ptr<TimelineSemaphore> m_renderTimeline;
+    std::unique_ptr<std::atomic<uint64_t>> m_computeValue;
+    std::unique_ptr<std::atomic<uint64_t>> m_renderValue;
 
     uint32_t m_imageIndex;
+    uint64_t m_frameCount = 0;
     vk::CommandBuffer* m_commandBuffer;
 
     static void ResizeWindow(GLFWwindow* window, int width, int height);
+    static void RefreshWindow(GLFWwindow* window);
+    static void ScrollWindow(GLFWwindow* window, double x, double y);
+    static void MoveCursor(GLFWwindow* window, double x, double y);
+    static void PressMouse(GLFWwindow* window, int button, int action, int mods);
 
     void createInstance();
     void selectPhysicalDevice();
+    void querySubgroupSupport();
+    void queryTimelineSupport();
+    void queryMemoryBudgetSupport();
     bool checkSwapchainSupport(const vk::PhysicalDevice& physicalDevice);
     bool isDeviceSuitable(const vk::PhysicalDevice& physicalDevice);
+    bool isComputeDeviceSuitable(const vk::PhysicalDevice& physicalDevice);
     void createSurface();
     void createDevice();
     void createCommandPool();
+    void createPipelineCache();
+    bool validatePipelineCache(const std::vector<char>& data);
     void recreateSwapchain();
     vk::SurfaceFormat chooseSurfaceFormat(const std::vector<vk::SurfaceFormat>& formats);
     vk::PresentMode choosePresentMode(const std::vector<vk::PresentMode>& modes);
@@ -88,5 +154,9 @@ private:
     void createCommandBuffers();
     void createFences();
     void createSemaphores();
+    void submitRender();
+    void submitRenderTimeline();
+    uint64_t submitComputeTimeline(vk::CommandBuffer& commandBuffer, vk::Fence* fence);
+    void submitTimeline(const vk::Queue& queue, vk::CommandBuffer& commandBuffer, const TimelineSubmit& submit, vk::Fence* fence);
     void preSignalComputeSemaphore();
 };
\ No newline at end of file
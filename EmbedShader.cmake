@@ -0,0 +1,15 @@
+# Converts a SPIR-V binary into a header holding it as a constexpr uint32_t array
+# cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DNAME=<identifier> -P EmbedShader.cmake
+
+file(READ "${INPUT}" HEX_DATA HEX)
+string(LENGTH "${HEX_DATA}" HEX_LENGTH)
+math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+
+if(HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a whole number of SPIR-V words")
+endif()
+
+# SPIR-V words are little endian, so each group of four bytes is reversed
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "    0x\\4\\3\\2\\1u,\n" WORDS "${HEX_DATA}")
+
+file(WRITE "${OUTPUT}" "#pragma once\n#include <cstdint>\n\nconstexpr uint32_t ${NAME}[] = {\n${WORDS}};\n")
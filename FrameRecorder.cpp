@@ -0,0 +1,203 @@
+#include "FrameRecorder.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+#include <sys/stat.h>
+#include "ImageFile.h"
+
+//frames that can wait for an encoder before the generator has to, fewer when large frames would not fit the budget
+#define FRAME_RING_SIZE 8
+#define MIN_FRAME_RING_SIZE 2
+//host memory for the canvas and the ring together
+#define FRAME_MEMORY_BUDGET (4ull * 1024 * 1024 * 1024)
+#define FRAME_RATE 30
+//frames used for the whole image when no interval is given
+#define DEFAULT_FRAME_COUNT 600
+
+FrameRecorder::FrameRecorder(const Options& options, std::streambuf* videoOutput) {
+    m_directory = options.frames;
+    m_format = options.frameFormat;
+    m_width = options.size.x;
+    m_height = options.size.y;
+    m_every = options.frameEvery;
+
+    if (m_every == 0) {
+        m_every = std::max<uint64_t>(static_cast<uint64_t>(m_width) * m_height / DEFAULT_FRAME_COUNT, 1);
+    }
+
+    //nothing is allocated or started until the output is known to work
+    if (m_format == FrameFormat::Y4M) {
+        if (m_directory == "-") {
+            m_stream = std::make_unique<std::ostream>(videoOutput);
+        } else {
+            std::string path = m_directory + "/frames.y4m";
+            m_stream = std::make_unique<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+            if (!*m_stream) {
+                m_error = "Could not open '" + path + "'";
+            }
+        }
+    } else {
+        struct stat info;
+        if (stat(m_directory.c_str(), &info) != 0 || (info.st_mode & S_IFDIR) == 0) {
+            m_error = "Frame directory '" + m_directory + "' does not exist";
+        }
+    }
+
+    if (!m_error.empty()) {
+        m_finished = true;
+        return;
+    }
+
+    m_canvas.resize(m_width * m_height);
+    m_frames.resize(ringSize(m_width, m_height));
+
+    for (auto& frame : m_frames) {
+        frame.pixels.resize(m_width * m_height);
+        m_free.push_back(&frame);
+    }
+
+    size_t encoders = 1;
+
+    if (m_format == FrameFormat::Y4M) {
+        //one stream, so frames are written by a single thread in order
+        writeY4MHeader(*m_stream, m_width, m_height, FRAME_RATE);
+    } else {
+        //leave a core for the generator
+        encoders = std::max(std::thread::hardware_concurrency() / 2, 1u);
+    }
+
+    for (size_t i = 0; i < encoders; i++) {
+        m_encoders.emplace_back([this]() -> void { encodeLoop(); });
+    }
+}
+
+FrameRecorder::~FrameRecorder() {
+    finish();
+}
+
+size_t FrameRecorder::ringSize(size_t width, size_t height) {
+    uint64_t frameBytes = static_cast<uint64_t>(width) * height * sizeof(Color32);
+    uint64_t frames = FRAME_MEMORY_BUDGET / frameBytes;
+
+    //the canvas takes one frame of the budget
+    if (frames < MIN_FRAME_RING_SIZE + 1) return 0;
+    return static_cast<size_t>(std::min<uint64_t>(frames - 1, FRAME_RING_SIZE));
+}
+
+uint64_t FrameRecorder::memoryBudget() {
+    return FRAME_MEMORY_BUDGET;
+}
+
+void FrameRecorder::place(glm::ivec2 pos, Color32 color) {
+    m_canvas[pos.x + pos.y * m_width] = color;
+    m_placed++;
+
+    if (m_placed % m_every == 0) {
+        snapshot();
+    }
+}
+
+void FrameRecorder::snapshot() {
+    Frame* frame;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        //only a full ring makes the generator wait
+        if (m_free.empty()) {
+            m_waits++;
+            m_freeCondition.wait(lock, [this]() { return !m_free.empty(); });
+        }
+
+        frame = m_free.front();
+        m_free.pop_front();
+    }
+
+    std::memcpy(frame->pixels.data(), m_canvas.data(), m_canvas.size() * sizeof(Color32));
+    frame->number = m_frameCount++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.push_back(frame);
+    }
+
+    m_readyCondition.notify_one();
+}
+
+void FrameRecorder::finish() {
+    if (m_finished) return;
+    m_finished = true;
+
+    if (m_placed % m_every != 0) {
+        snapshot();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_readyCondition.notify_all();
+
+    for (auto& thread : m_encoders) {
+        thread.join();
+    }
+
+    std::cout << "Frames: " << m_frameCount << " written, generator waited for the encoders " << m_waits << " times\n";
+
+    if (m_stream != nullptr) {
+        m_stream->flush();
+        m_stream.reset();
+    }
+}
+
+void FrameRecorder::encodeLoop() {
+    while (true) {
+        Frame* frame;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_readyCondition.wait(lock, [this]() { return m_stopping || !m_ready.empty(); });
+
+            if (m_ready.empty()) return;
+
+            frame = m_ready.front();
+            m_ready.pop_front();
+        }
+
+        encode(*frame);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(frame);
+        }
+
+        m_freeCondition.notify_one();
+    }
+}
+
+void FrameRecorder::encode(Frame& frame) {
+    if (m_format == FrameFormat::Y4M) {
+        writeY4MFrame(*m_stream, m_width, m_height, frame.pixels.data());
+        return;
+    }
+
+    std::stringstream builder;
+    builder << m_directory << "/frame" << std::setw(6) << std::setfill('0') << frame.number;
+
+    try {
+        if (m_format == FrameFormat::PNG) {
+            builder << ".png";
+            savePNG(builder.str(), m_width, m_height, frame.pixels.data());
+        } else {
+            builder << ".qoi";
+            saveQOI(builder.str(), m_width, m_height, frame.pixels.data());
+        }
+    }
+    catch (std::exception& e) {
+        std::cerr << "Error: Could not write frame '" << builder.str() << "': " << e.what() << "\n";
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <glm/glm.hpp>
+#include "Bitmap.h"
+#include "Options.h"
+#include "MemoryTracker.h"
+
+//copies the image into a ring of frames every few placed pixels, and encodes them on background threads
+class FrameRecorder {
+    using FramePixels = std::vector<Color32, TrackingAllocator<Color32, MemoryCategory::Frames>>;
+
+    struct Frame {
+        FramePixels pixels;
+        uint32_t number;
+    };
+
+public:
+    //videoOutput is where a y4m video goes when streaming to stdout
+    FrameRecorder(const Options& options, std::streambuf* videoOutput);
+    FrameRecorder(const FrameRecorder& other) = delete;
+    FrameRecorder& operator = (const FrameRecorder& other) = delete;
+    ~FrameRecorder();
+
+    //frames the ring holds for this size within the memory budget, 0 when not even the minimum fits
+    static size_t ringSize(size_t width, size_t height);
+    static uint64_t memoryBudget();
+
+    //false when the output could not be opened, and then nothing is recorded
+    bool valid() const { return m_error.empty(); }
+    const std::string& error() const { return m_error; }
+
+    //called from the enqueueing thread of the color queue, only one thread at a time
+    void place(glm::ivec2 pos, Color32 color);
+    //snapshots the last pixels and waits for every frame to be written
+    void finish();
+
+private:
+    std::string m_directory;
+    FrameFormat m_format;
+    size_t m_width;
+    size_t m_height;
+    uint64_t m_every;
+    uint64_t m_placed = 0;
+    uint32_t m_frameCount = 0;
+    std::string m_error;
+
+    FramePixels m_canvas;
+    std::vector<Frame> m_frames;
+
+    std::mutex m_mutex;
+    std::condition_variable m_freeCondition;
+    std::condition_variable m_readyCondition;
+    std::deque<Frame*> m_free;
+    std::deque<Frame*> m_ready;
+    std::vector<std::thread> m_encoders;
+    bool m_stopping = false;
+    bool m_finished = false;
+    uint32_t m_waits = 0;
+
+    std::unique_ptr<std::ostream> m_stream;
+
+    void snapshot();
+    void encodeLoop();
+    void encode(Frame& frame);
+};
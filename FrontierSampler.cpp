@@ -0,0 +1,88 @@
+#include "FrontierSampler.h"
+#include <algorithm>
+
+//winners whose surroundings are always scored, since similar colors tend to land together
+#define SAMPLER_WINNERS 8
+#define SAMPLER_RADIUS 2
+//how far the sample can grow when the sampled pixels match poorly
+#define SAMPLER_MAX_GROWTH 16
+//a winning score this many times the recent average counts as a poor match
+#define SAMPLER_POOR_MATCH 2.0f
+
+FrontierSampler::FrontierSampler(uint32_t sampleSize, uint32_t seed) {
+    m_baseSize = sampleSize;
+    m_sampleSize = sampleSize;
+    m_random.seed(seed);
+}
+
+void FrontierSampler::add(glm::ivec2 pos) {
+    if (m_indices.count(pos) != 0) return;
+
+    m_indices[pos] = m_open.size();
+    m_open.push_back(pos);
+}
+
+void FrontierSampler::remove(glm::ivec2 pos) {
+    auto it = m_indices.find(pos);
+    if (it == m_indices.end()) return;
+
+    //swap with the last pixel so removal does not shift the list
+    size_t index = it->second;
+    glm::ivec2 last = m_open.back();
+    m_open[index] = last;
+    m_indices[last] = index;
+    m_open.pop_back();
+    m_indices.erase(pos);
+}
+
+void FrontierSampler::sample(OpenList& list) {
+    list.clear();
+
+    if (m_open.size() <= m_sampleSize) {
+        list.insert(list.end(), m_open.begin(), m_open.end());
+        return;
+    }
+
+    //one random pixel from each equal slice of the list, so no part of the frontier is skipped entirely
+    float stride = m_open.size() / static_cast<float>(m_sampleSize);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    for (uint32_t i = 0; i < m_sampleSize; i++) {
+        size_t index = static_cast<size_t>((i + dist(m_random)) * stride);
+        list.push_back(m_open[std::min(index, m_open.size() - 1)]);
+    }
+
+    for (auto winner : m_winners) {
+        for (int32_t y = -SAMPLER_RADIUS; y <= SAMPLER_RADIUS; y++) {
+            for (int32_t x = -SAMPLER_RADIUS; x <= SAMPLER_RADIUS; x++) {
+                glm::ivec2 pos = winner + glm::ivec2{ x, y };
+                if (m_indices.count(pos) != 0) {
+                    list.push_back(pos);
+                }
+            }
+        }
+    }
+}
+
+void FrontierSampler::place(glm::ivec2 pos, int32_t score) {
+    if (m_winners.size() < SAMPLER_WINNERS) {
+        m_winners.push_back(pos);
+    } else {
+        m_winners[m_nextWinner] = pos;
+        m_nextWinner = (m_nextWinner + 1) % SAMPLER_WINNERS;
+    }
+
+    if (m_averageScore == 0.0f) {
+        m_averageScore = static_cast<float>(score);
+        return;
+    }
+
+    //grow quickly after a poor match and shrink slowly back to the requested size
+    if (score > m_averageScore * SAMPLER_POOR_MATCH) {
+        m_sampleSize = std::min(m_sampleSize * 2, m_baseSize * SAMPLER_MAX_GROWTH);
+    } else if (m_sampleSize > m_baseSize) {
+        m_sampleSize = std::max(static_cast<uint32_t>(m_sampleSize * 0.95f), m_baseSize);
+    }
+
+    m_averageScore = m_averageScore * 0.99f + score * 0.01f;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <glm/glm.hpp>
+#include "Utilities.h"
+
+//picks a bounded subset of the open pixels to score, for the approximate cpu generators
+class FrontierSampler {
+public:
+    FrontierSampler(uint32_t sampleSize, uint32_t seed);
+
+    void add(glm::ivec2 pos);
+    void remove(glm::ivec2 pos);
+    void sample(OpenList& list);
+    void place(glm::ivec2 pos, int32_t score);
+
+    uint32_t sampleSize() const { return m_sampleSize; }
+
+private:
+    OpenList m_open;
+    std::unordered_map<glm::ivec2, size_t, std::hash<glm::ivec2>, std::equal_to<glm::ivec2>,
+        TrackingAllocator<std::pair<const glm::ivec2, size_t>, MemoryCategory::OpenSet>> m_indices;
+    std::vector<glm::ivec2> m_winners;
+    size_t m_nextWinner = 0;
+    std::default_random_engine m_random;
+
+    uint32_t m_baseSize;
+    uint32_t m_sampleSize;
+    float m_averageScore = 0.0f;
+};
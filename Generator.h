@@ -4,5 +4,7 @@ class Generator {
 public:
     virtual void run() = 0;
     virtual void stop() = 0;
+    //true once every color is placed or no open pixels are left
+    virtual bool finished() = 0;
     virtual ~Generator() {}
 };
\ No newline at end of file
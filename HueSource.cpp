@@ -33,19 +33,19 @@ int getHue(Color32 color) {
     return static_cast<int>(round(hue));
 }
 
-HueSource::HueSource(const Options& options) {
-    std::vector<Color32> colors;
-    uint32_t bitDepth = options.bitDepth;
-
-    uint32_t max = static_cast<uint32_t>(pow(2, bitDepth));
-    for (uint32_t r = 0; r < max; r++) {
-        for (uint32_t g = 0; g < max; g++) {
-            for (uint32_t b = 0; b < max; b++) {
-                Color32 color = { map(r, bitDepth), map(g, bitDepth), map(b, bitDepth), 255 };
-                colors.push_back(color);
-            }
-        }
-    }
+HueSource::HueSource(const Options& options) : HueSource(createPalette(options)) {}
+
+HueSource::HueSource(Palette palette) {
+    m_palette = std::move(palette);
+}
+
+Palette HueSource::createPalette(const Options& options) {
+    return sortByHue(*createColors(options.bitDepth));
+}
+
+Palette HueSource::sortByHue(const PaletteColors& source) {
+    auto palette = std::make_shared<PaletteColors>(source);
+    auto& colors = *palette;
 
     std::sort(colors.begin(), colors.end(),
         [](Color32 a, Color32 b) -> bool {
@@ -53,9 +53,7 @@ HueSource::HueSource(const Options& options) {
         }
     );
 
-    for (Color32 color : colors) {
-        m_colors.push_back(color);
-    }
+    return palette;
 }
 
 HueSource::HueSource(HueSource&& other) {
@@ -63,15 +61,20 @@ HueSource::HueSource(HueSource&& other) {
 }
 
 bool HueSource::hasNext() {
-    return m_colors.size() > 0;
+    return m_resubmitted.size() > 0 || m_next < m_palette->size();
 }
 
 Color32 HueSource::getNext() {
-    auto result = m_colors.front();
-    m_colors.pop_front();
-    return result;
+    if (m_resubmitted.size() > 0) {
+        auto result = m_resubmitted.back();
+        m_resubmitted.pop_back();
+        return result;
+    }
+
+    return (*m_palette)[m_next++];
 }
 
+//resubmitted colors come next, so the hue order is kept
 void HueSource::resubmit(Color32 color) {
-    m_colors.push_front(color);
+    m_resubmitted.push_back(color);
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 class HueSource : public ColorSource {
 public:
     HueSource(const Options& options);
+    HueSource(Palette palette);
     HueSource(const HueSource& other) = delete;
     HueSource& operator = (const HueSource& other) = delete;
     HueSource(HueSource&& other);
@@ -15,6 +16,12 @@ public:
     Color32 getNext();
     void resubmit(Color32 color);
 
+    static Palette createPalette(const Options& options);
+    //a copy of the colors in hue order, which does not depend on the seed
+    static Palette sortByHue(const PaletteColors& colors);
+
 private:
-    std::deque<Color32> m_colors;
+    Palette m_palette;
+    size_t m_next = 0;
+    std::deque<Color32, TrackingAllocator<Color32, MemoryCategory::Palette>> m_resubmitted;
 };
\ No newline at end of file
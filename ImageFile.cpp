@@ -0,0 +1,341 @@
+#include "ImageFile.h"
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <array>
+
+void savePPM(const std::string& path, Bitmap& bitmap) {
+    std::ofstream file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Could not open file");
+
+    file << "P6\n" << bitmap.width() << " " << bitmap.height() << "\n255\n";
+
+    //one row at a time, dropping alpha
+    std::vector<uint8_t> row(bitmap.width() * 3);
+
+    for (size_t y = 0; y < bitmap.height(); y++) {
+        for (size_t x = 0; x < bitmap.width(); x++) {
+            Color32 color = bitmap.getPixel(x, y);
+            row[x * 3 + 0] = color.r;
+            row[x * 3 + 1] = color.g;
+            row[x * 3 + 2] = color.b;
+        }
+
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    if (!file) throw std::runtime_error("Could not write file");
+}
+
+//writes bits least significant first, as deflate expects
+class BitWriter {
+public:
+    BitWriter(std::vector<uint8_t>& output) : m_output(&output) {}
+
+    void write(uint32_t bits, uint32_t count) {
+        m_buffer |= static_cast<uint64_t>(bits) << m_count;
+        m_count += count;
+
+        while (m_count >= 8) {
+            m_output->push_back(static_cast<uint8_t>(m_buffer));
+            m_buffer >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    //huffman codes are defined most significant bit first
+    void writeCode(uint32_t code, uint32_t count) {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            reversed |= ((code >> i) & 1) << (count - 1 - i);
+        }
+        write(reversed, count);
+    }
+
+    void flush() {
+        if (m_count > 0) {
+            m_output->push_back(static_cast<uint8_t>(m_buffer));
+            m_buffer = 0;
+            m_count = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>* m_output;
+    uint64_t m_buffer = 0;
+    uint32_t m_count = 0;
+};
+
+const uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DISTANCE_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_HASH_BITS 15
+//bytes of compressed data per IDAT chunk
+#define PNG_CHUNK_SIZE 65536
+
+void writeSymbol(BitWriter& writer, uint32_t symbol) {
+    if (symbol < 144) {
+        writer.writeCode(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        writer.writeCode(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        writer.writeCode(symbol - 256, 7);
+    } else {
+        writer.writeCode(0xC0 + symbol - 280, 8);
+    }
+}
+
+void writeMatch(BitWriter& writer, uint32_t length, uint32_t distance) {
+    uint32_t lengthCode = 28;
+    while (LENGTH_BASE[lengthCode] > length) lengthCode--;
+    writeSymbol(writer, 257 + lengthCode);
+    writer.write(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+    uint32_t distanceCode = 29;
+    while (DISTANCE_BASE[distanceCode] > distance) distanceCode--;
+    writer.writeCode(distanceCode, 5);
+    writer.write(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+}
+
+//one block with the fixed codes and a single match candidate per position, fast rather than small
+std::vector<uint8_t> deflate(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> output;
+    BitWriter writer = BitWriter(output);
+    std::vector<int64_t> table(size_t(1) << DEFLATE_HASH_BITS, -1);
+
+    writer.write(1, 1);
+    writer.write(1, 2);
+
+    size_t i = 0;
+    while (i < data.size()) {
+        uint32_t length = 0;
+        size_t distance = 0;
+
+        if (i + DEFLATE_MIN_MATCH <= data.size()) {
+            uint32_t hash = ((data[i] << 16) | (data[i + 1] << 8) | data[i + 2]) * 2654435761u >> (32 - DEFLATE_HASH_BITS);
+            int64_t candidate = table[hash];
+            table[hash] = static_cast<int64_t>(i);
+
+            if (candidate >= 0 && i - static_cast<size_t>(candidate) <= DEFLATE_WINDOW) {
+                size_t limit = std::min(data.size() - i, static_cast<size_t>(DEFLATE_MAX_MATCH));
+                while (length < limit && data[candidate + length] == data[i + length]) length++;
+                distance = i - static_cast<size_t>(candidate);
+            }
+        }
+
+        if (length >= DEFLATE_MIN_MATCH) {
+            writeMatch(writer, length, static_cast<uint32_t>(distance));
+            i += length;
+        } else {
+            writeSymbol(writer, data[i]);
+            i++;
+        }
+    }
+
+    writeSymbol(writer, 256);
+    writer.flush();
+    return output;
+}
+
+std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table;
+
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (size_t k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+
+    return table;
+}
+
+//continues from the crc of the bytes before, 0 to start
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t previous = 0) {
+    //built once, frames can be encoded on several threads
+    static const std::array<uint32_t, 256> table = makeCrcTable();
+
+    uint32_t crc = ~previous;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void writeBigEndian(std::ostream& stream, uint32_t value) {
+    char bytes[4] = { static_cast<char>(value >> 24), static_cast<char>(value >> 16), static_cast<char>(value >> 8), static_cast<char>(value) };
+    stream.write(bytes, 4);
+}
+
+void writeChunk(std::ostream& stream, const char* type, const uint8_t* data, size_t size) {
+    writeBigEndian(stream, static_cast<uint32_t>(size));
+    stream.write(type, 4);
+    stream.write(reinterpret_cast<const char*>(data), size);
+
+    uint32_t crc = crc32(reinterpret_cast<const uint8_t*>(type), 4);
+    writeBigEndian(stream, crc32(data, size, crc));
+}
+
+void savePNG(const std::string& path, size_t width, size_t height, const Color32* pixels) {
+    std::ofstream file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Could not open file");
+
+    //each row starts with its filter type, always none here
+    std::vector<uint8_t> raw;
+    raw.reserve((width * 3 + 1) * height);
+
+    for (size_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        for (size_t x = 0; x < width; x++) {
+            Color32 color = pixels[x + y * width];
+            raw.push_back(color.r);
+            raw.push_back(color.g);
+            raw.push_back(color.b);
+        }
+    }
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t value : raw) {
+        a = (a + value) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    std::vector<uint8_t> idat = { 0x78, 0x01 };
+    std::vector<uint8_t> compressed = deflate(raw);
+    idat.insert(idat.end(), compressed.begin(), compressed.end());
+    uint32_t adler = (b << 16) | a;
+    idat.push_back(static_cast<uint8_t>(adler >> 24));
+    idat.push_back(static_cast<uint8_t>(adler >> 16));
+    idat.push_back(static_cast<uint8_t>(adler >> 8));
+    idat.push_back(static_cast<uint8_t>(adler));
+
+    std::vector<uint8_t> ihdr = {
+        static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16), static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+        static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16), static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+        8, 2, 0, 0, 0
+    };
+
+    const char signature[] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1A', '\n' };
+    file.write(signature, sizeof(signature));
+    writeChunk(file, "IHDR", ihdr.data(), ihdr.size());
+
+    //chunk lengths are limited to 2^31 - 1, so large images need several
+    for (size_t offset = 0; offset < idat.size(); offset += PNG_CHUNK_SIZE) {
+        writeChunk(file, "IDAT", idat.data() + offset, std::min<size_t>(PNG_CHUNK_SIZE, idat.size() - offset));
+    }
+
+    writeChunk(file, "IEND", nullptr, 0);
+
+    if (!file) throw std::runtime_error("Could not write file");
+}
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xC0
+#define QOI_OP_RGB 0xFE
+
+void saveQOI(const std::string& path, size_t width, size_t height, const Color32* pixels) {
+    std::ofstream file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Could not open file");
+
+    std::vector<uint8_t> output;
+    output.reserve(width * height + 64);
+
+    Color32 index[64] = {};
+    Color32 previous = { 0, 0, 0, 255 };
+    uint32_t run = 0;
+    size_t count = width * height;
+
+    for (size_t i = 0; i < count; i++) {
+        Color32 color = { pixels[i].r, pixels[i].g, pixels[i].b, 255 };
+
+        if (color.r == previous.r && color.g == previous.g && color.b == previous.b) {
+            run++;
+            if (run == 62 || i == count - 1) {
+                output.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            output.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+            run = 0;
+        }
+
+        size_t hash = (color.r * 3 + color.g * 5 + color.b * 7 + color.a * 11) % 64;
+        Color32 indexed = index[hash];
+
+        if (indexed.r == color.r && indexed.g == color.g && indexed.b == color.b && indexed.a == color.a) {
+            output.push_back(static_cast<uint8_t>(QOI_OP_INDEX | hash));
+        } else {
+            index[hash] = color;
+
+            int8_t dr = static_cast<int8_t>(color.r - previous.r);
+            int8_t dg = static_cast<int8_t>(color.g - previous.g);
+            int8_t db = static_cast<int8_t>(color.b - previous.b);
+            int8_t drg = static_cast<int8_t>(dr - dg);
+            int8_t dbg = static_cast<int8_t>(db - dg);
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                output.push_back(static_cast<uint8_t>(QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+            } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                output.push_back(static_cast<uint8_t>(QOI_OP_LUMA | (dg + 32)));
+                output.push_back(static_cast<uint8_t>(((drg + 8) << 4) | (dbg + 8)));
+            } else {
+                output.push_back(QOI_OP_RGB);
+                output.push_back(color.r);
+                output.push_back(color.g);
+                output.push_back(color.b);
+            }
+        }
+
+        previous = color;
+    }
+
+    file.write("qoif", 4);
+    writeBigEndian(file, static_cast<uint32_t>(width));
+    writeBigEndian(file, static_cast<uint32_t>(height));
+    //three channels, sRGB
+    const char format[] = { 3, 0 };
+    file.write(format, sizeof(format));
+    file.write(reinterpret_cast<const char*>(output.data()), output.size());
+
+    const char end[] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    file.write(end, sizeof(end));
+
+    if (!file) throw std::runtime_error("Could not write file");
+}
+
+void writeY4MHeader(std::ostream& stream, size_t width, size_t height, uint32_t fps) {
+    //full resolution chroma, so single pixels keep their color
+    stream << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C444\n";
+}
+
+void writeY4MFrame(std::ostream& stream, size_t width, size_t height, const Color32* pixels) {
+    size_t count = width * height;
+    std::vector<uint8_t> planes(count * 3);
+
+    //BT.601 studio range, which players assume when nothing else is given
+    for (size_t i = 0; i < count; i++) {
+        float r = pixels[i].r;
+        float g = pixels[i].g;
+        float b = pixels[i].b;
+
+        planes[i] = static_cast<uint8_t>(16.0f + 0.257f * r + 0.504f * g + 0.098f * b + 0.5f);
+        planes[count + i] = static_cast<uint8_t>(128.0f - 0.148f * r - 0.291f * g + 0.439f * b + 0.5f);
+        planes[count * 2 + i] = static_cast<uint8_t>(128.0f + 0.439f * r - 0.368f * g - 0.071f * b + 0.5f);
+    }
+
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(planes.data()), planes.size());
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <ostream>
+#include "Bitmap.h"
+
+void savePPM(const std::string& path, Bitmap& bitmap);
+
+//these drop alpha, so unplaced pixels come out black
+void savePNG(const std::string& path, size_t width, size_t height, const Color32* pixels);
+void saveQOI(const std::string& path, size_t width, size_t height, const Color32* pixels);
+void writeY4MHeader(std::ostream& stream, size_t width, size_t height, uint32_t fps);
+void writeY4MFrame(std::ostream& stream, size_t width, size_t height, const Color32* pixels);
@@ -0,0 +1,221 @@
+#include "JobRunner.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include "ShuffleSource.h"
+#include "HueSource.h"
+#include "ComputeGenerator.h"
+#include "WaveGenerator.h"
+#include "CoralGenerator.h"
+#include "ImageFile.h"
+#include "Utilities.h"
+
+//shader jobs mostly wait on the GPU, so a couple at once keeps the queue busy without running out of memory
+#define JOB_GPU_SLOTS 2
+#define JOB_POLL_INTERVAL 10
+
+JobRunner::JobRunner(Core& core, Allocator& allocator, const std::vector<std::string>& arguments, uint32_t workGroupSize) {
+    m_core = &core;
+    m_allocator = &allocator;
+    m_arguments = arguments;
+    m_workGroupSize = workGroupSize;
+    //each CPU generator is one thread
+    m_cpuSlots = std::max(std::thread::hardware_concurrency(), 1u);
+    m_gpuSlots = JOB_GPU_SLOTS;
+}
+
+bool JobRunner::load(const std::string& path) {
+    std::ifstream file = std::ifstream(path);
+    if (!file) {
+        std::cout << "Error: Could not open job file '" << path << "'\n";
+        return false;
+    }
+
+    uint32_t maxImageDimension = m_core->device().physicalDevice().properties().limits.maxImageDimension2D;
+    bool valid = true;
+    std::string line;
+    size_t lineNumber = 0;
+
+    //one job per line, written like the command line; the command line's own options are the defaults
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line = line.substr(0, comment);
+        }
+
+        std::vector<std::string> arguments = m_arguments;
+        std::istringstream stream = std::istringstream(line);
+        std::string token;
+        size_t tokens = 0;
+
+        while (stream >> token) {
+            arguments.push_back(token);
+            tokens++;
+        }
+
+        if (tokens == 0) continue;
+
+        Options options = parseArguments(arguments);
+
+        if (options.valid && options.generator == GeneratorType::Shader
+            && static_cast<uint32_t>(std::max(options.size.x, options.size.y)) > maxImageDimension) {
+            std::cout << "Error: The shader generators are limited to " << maxImageDimension << "x" << maxImageDimension << " on this device\n";
+            options.valid = false;
+        }
+
+        if (options.valid && !options.frames.empty()) {
+            std::cout << "Error: Frames are not recorded for jobs\n";
+            options.valid = false;
+        }
+
+        if (!options.valid) {
+            std::cout << "Error: Invalid job on line " << lineNumber << " of '" << path << "'\n";
+            valid = false;
+            continue;
+        }
+
+        if (!options.userWorkGroupSize) {
+            options.workGroupSize = m_workGroupSize;
+        }
+
+        m_queued.push_back(m_jobs.size());
+        m_jobs.push_back(options);
+    }
+
+    return valid;
+}
+
+Palette JobRunner::getPalette(const Options& options) {
+    Palette& colors = m_colors[options.bitDepth];
+    if (colors == nullptr) {
+        colors = ColorSource::createColors(options.bitDepth);
+    }
+
+    if (options.source == Source::Shuffle) {
+        return ShuffleSource::shuffle(*colors, options.seed);
+    }
+
+    Palette& palette = m_huePalettes[options.bitDepth];
+    if (palette == nullptr) {
+        palette = HueSource::sortByHue(*colors);
+    }
+
+    return palette;
+}
+
+std::unique_ptr<JobRunner::Job> JobRunner::startJob(size_t index) {
+    auto job = std::make_unique<Job>();
+    job->index = index;
+    job->options = m_jobs[index];
+    job->gpu = job->options.generator == GeneratorType::Shader;
+    job->colorQueue = std::make_unique<ColorQueue>();
+
+    Options& options = job->options;
+
+    if (options.source == Source::Shuffle) {
+        job->source = std::make_unique<ShuffleSource>(getPalette(options));
+    } else {
+        job->source = std::make_unique<HueSource>(getPalette(options));
+    }
+
+    if (!options.output.empty()) {
+        job->bitmap = std::make_unique<Bitmap>(options.size.x, options.size.y);
+    }
+
+    //shader jobs reuse pipelines through the pipeline cache, so only the first one of each kind compiles
+    if (job->gpu) {
+        job->generator = std::make_unique<ComputeGenerator>(*m_core, *m_allocator, *job->source, *job->colorQueue, options);
+    } else if (options.generator == GeneratorType::CPUCoral) {
+        job->generator = std::make_unique<CoralGenerator>(*job->source, *job->colorQueue, options);
+    } else {
+        job->generator = std::make_unique<WaveGenerator>(*job->source, *job->colorQueue, options);
+    }
+
+    job->start = std::chrono::steady_clock::now();
+    job->generator->run();
+
+    return job;
+}
+
+void JobRunner::drain(Job& job) {
+    auto& changes = job.colorQueue->swap();
+    if (job.bitmap == nullptr) return;
+
+    for (auto& item : changes) {
+        job.bitmap->getPixel(item.pos.x, item.pos.y) = item.color;
+    }
+}
+
+void JobRunner::finishJob(Job& job) {
+    job.generator->stop();
+    drain(job);
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start).count();
+    size_t pixels = job.colorQueue->totalCount();
+    m_totalPixels += pixels;
+
+    if (job.bitmap != nullptr) {
+        savePPM(job.options.output, *job.bitmap);
+    }
+
+    //running jobs print their own summaries from their threads
+    std::lock_guard<std::mutex> lock(outputMutex());
+    std::cout << std::setprecision(2) << std::fixed;
+    std::cout << "Job " << job.index + 1 << ": " << job.options.size.x << "x" << job.options.size.y << " seed " << job.options.seed
+        << ", " << pixels << " in " << elapsed << "s (" << static_cast<size_t>(pixels / elapsed) << " pps)";
+
+    if (job.bitmap != nullptr) {
+        std::cout << " -> " << job.options.output;
+    }
+
+    std::cout << "\n";
+}
+
+void JobRunner::run() {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t cpuRunning = 0;
+    uint32_t gpuRunning = 0;
+
+    while (!m_queued.empty() || !m_running.empty()) {
+        //jobs start in file order, but a job waiting for a GPU slot does not hold back CPU jobs behind it
+        for (auto it = m_queued.begin(); it != m_queued.end();) {
+            bool gpu = m_jobs[*it].generator == GeneratorType::Shader;
+            uint32_t& running = gpu ? gpuRunning : cpuRunning;
+            uint32_t slots = gpu ? m_gpuSlots : m_cpuSlots;
+
+            if (running < slots) {
+                m_running.push_back(startJob(*it));
+                running++;
+                it = m_queued.erase(it);
+            } else {
+                it++;
+            }
+        }
+
+        for (auto it = m_running.begin(); it != m_running.end();) {
+            Job& job = **it;
+
+            if (job.generator->finished()) {
+                finishJob(job);
+                (job.gpu ? gpuRunning : cpuRunning)--;
+                it = m_running.erase(it);
+            } else {
+                drain(job);
+                it++;
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(JOB_POLL_INTERVAL));
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::setprecision(2) << std::fixed;
+    std::cout << "Jobs: " << m_jobs.size() << " in " << elapsed << "s (" << m_jobs.size() / elapsed << " jobs/s), "
+        << m_totalPixels << " pixels (" << static_cast<size_t>(m_totalPixels / elapsed) << " pps)\n";
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <chrono>
+#include "Core.h"
+#include "Allocator.h"
+#include "ColorSource.h"
+#include "ColorQueue.h"
+#include "Generator.h"
+#include "Bitmap.h"
+#include "Options.h"
+
+//runs every image of a job file in one process, sharing the device, pipeline cache and palettes
+class JobRunner {
+    struct Job {
+        size_t index;
+        Options options;
+        bool gpu;
+        std::unique_ptr<ColorSource> source;
+        std::unique_ptr<ColorQueue> colorQueue;
+        std::unique_ptr<Generator> generator;
+        std::unique_ptr<Bitmap> bitmap;
+        std::chrono::steady_clock::time_point start;
+    };
+
+public:
+    JobRunner(Core& core, Allocator& allocator, const std::vector<std::string>& arguments, uint32_t workGroupSize);
+    JobRunner(const JobRunner& other) = delete;
+    JobRunner& operator = (const JobRunner& other) = delete;
+
+    bool load(const std::string& path);
+    void run();
+
+private:
+    Core* m_core;
+    Allocator* m_allocator;
+    std::vector<std::string> m_arguments;
+    uint32_t m_workGroupSize;
+    uint32_t m_cpuSlots;
+    uint32_t m_gpuSlots;
+    std::vector<Options> m_jobs;
+    std::vector<size_t> m_queued;
+    std::vector<std::unique_ptr<Job>> m_running;
+    //unshuffled colors per bit depth, kept for the whole run, each shuffle job gets its own copy in seed order
+    std::map<int32_t, Palette> m_colors;
+    //hue order does not depend on the seed, so every hue job of a bit depth shares one palette
+    std::map<int32_t, Palette> m_huePalettes;
+    size_t m_totalPixels = 0;
+
+    Palette getPalette(const Options& options);
+    std::unique_ptr<Job> startJob(size_t index);
+    void drain(Job& job);
+    void finishJob(Job& job);
+};
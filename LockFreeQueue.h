@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+//bounded ring buffer, safe for exactly one producer thread and one consumer thread
+template <typename T>
+class LockFreeQueue {
+public:
+    LockFreeQueue(size_t capacity) : m_buffer(capacity + 1) {}
+    LockFreeQueue(const LockFreeQueue& other) = delete;
+    LockFreeQueue& operator = (const LockFreeQueue& other) = delete;
+
+    bool push(const T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = increment(tail);
+        if (next == m_head.load(std::memory_order_acquire)) return false;
+
+        m_buffer[tail] = item;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+
+        item = m_buffer[head];
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return m_buffer.size() - 1; }
+
+private:
+    std::vector<T> m_buffer;
+    alignas(64) std::atomic<size_t> m_head = { 0 };
+    alignas(64) std::atomic<size_t> m_tail = { 0 };
+
+    size_t increment(size_t index) const {
+        index++;
+        return index == m_buffer.size() ? 0 : index;
+    }
+};
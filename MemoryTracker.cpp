@@ -0,0 +1,136 @@
+#include "MemoryTracker.h"
+#include "Allocator.h"
+#include <atomic>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#define MEMORY_CATEGORIES static_cast<size_t>(MemoryCategory::Count)
+
+const char* MEMORY_CATEGORY_NAMES[] = { "bitmap", "palette", "openSet", "colorQueue", "staging", "frames", "neighborSums" };
+
+struct MemoryCounters {
+    std::atomic<size_t> live;
+    std::atomic<size_t> peak;
+    std::atomic<size_t> allocations;
+};
+
+//zero initialized before any container is constructed, since it has static storage
+static MemoryCounters counters[MEMORY_CATEGORIES];
+
+void MemoryTracker::allocate(MemoryCategory category, size_t size) {
+    auto& counter = counters[static_cast<size_t>(category)];
+    size_t live = counter.live.fetch_add(size, std::memory_order_relaxed) + size;
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+
+    size_t peak = counter.peak.load(std::memory_order_relaxed);
+    while (live > peak && !counter.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+void MemoryTracker::free(MemoryCategory category, size_t size) {
+    counters[static_cast<size_t>(category)].live.fetch_sub(size, std::memory_order_relaxed);
+}
+
+const char* MemoryTracker::name(MemoryCategory category) {
+    return MEMORY_CATEGORY_NAMES[static_cast<size_t>(category)];
+}
+
+MemoryStats MemoryTracker::stats(MemoryCategory category) {
+    auto& counter = counters[static_cast<size_t>(category)];
+    return { counter.live.load(), counter.peak.load(), counter.allocations.load() };
+}
+
+size_t MemoryTracker::live() {
+    size_t result = 0;
+
+    for (size_t i = 0; i < MEMORY_CATEGORIES; i++) {
+        result += counters[i].live.load(std::memory_order_relaxed);
+    }
+
+    return result;
+}
+
+size_t MemoryTracker::currentRSS() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS info = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info))) return 0;
+    return info.WorkingSetSize;
+#else
+    //second field of statm is resident pages
+    std::ifstream file = std::ifstream("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    if (!(file >> pages >> resident)) return 0;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t MemoryTracker::peakRSS() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS info = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info))) return 0;
+    return info.PeakWorkingSetSize;
+#else
+    rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    //kilobytes on linux
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void MemoryTracker::printSummary() {
+    for (size_t i = 0; i < MEMORY_CATEGORIES; i++) {
+        MemoryStats stats = MemoryTracker::stats(static_cast<MemoryCategory>(i));
+        if (stats.allocations == 0) continue;
+
+        std::cout << "Memory " << MEMORY_CATEGORY_NAMES[i] << ": " << stats.live / 1024 << " KB live, "
+            << stats.peak / 1024 << " KB peak, " << stats.allocations << " allocations\n";
+    }
+
+    std::cout << "Peak RSS: " << peakRSS() / (1024 * 1024) << " MB\n";
+}
+
+void MemoryTracker::writeReport(const std::string& path, const std::vector<HeapStats>& heaps) {
+    std::ofstream file = std::ofstream(path, std::ios::trunc);
+    if (!file) throw std::runtime_error("Could not open file");
+
+    //all sizes in bytes
+    file << "{\n";
+    file << "  \"peakRSS\": " << peakRSS() << ",\n";
+    file << "  \"currentRSS\": " << currentRSS() << ",\n";
+    file << "  \"host\": {\n";
+
+    for (size_t i = 0; i < MEMORY_CATEGORIES; i++) {
+        MemoryStats stats = MemoryTracker::stats(static_cast<MemoryCategory>(i));
+        file << "    \"" << MEMORY_CATEGORY_NAMES[i] << "\": { \"live\": " << stats.live << ", \"peak\": " << stats.peak
+            << ", \"allocations\": " << stats.allocations << " }" << (i + 1 < MEMORY_CATEGORIES ? "," : "") << "\n";
+    }
+
+    file << "  },\n";
+    file << "  \"deviceHeaps\": [\n";
+
+    for (size_t i = 0; i < heaps.size(); i++) {
+        auto& heap = heaps[i];
+        file << "    { \"size\": " << heap.size << ", \"budget\": " << heap.budget << ", \"allocated\": " << heap.allocated
+            << ", \"live\": " << heap.live << ", \"peak\": " << heap.peak << ", \"wasted\": " << heap.wasted << " }"
+            << (i + 1 < heaps.size() ? "," : "") << "\n";
+    }
+
+    file << "  ]\n";
+    file << "}\n";
+
+    if (!file) throw std::runtime_error("Could not write file");
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+//only declared, so including this does not pull in Vulkan
+struct HeapStats;
+
+enum class MemoryCategory {
+    Bitmap,
+    Palette,
+    OpenSet,
+    ColorQueue,
+    Staging,
+    Frames,
+    NeighborSums,
+    Count
+};
+
+struct MemoryStats {
+    size_t live;
+    size_t peak;
+    size_t allocations;
+};
+
+//host memory held by the large containers, counted through their allocators
+class MemoryTracker {
+public:
+    static void allocate(MemoryCategory category, size_t size);
+    static void free(MemoryCategory category, size_t size);
+
+    static const char* name(MemoryCategory category);
+    static MemoryStats stats(MemoryCategory category);
+    static size_t live();
+    static size_t currentRSS();
+    static size_t peakRSS();
+
+    static void printSummary();
+    static void writeReport(const std::string& path, const std::vector<HeapStats>& heaps);
+};
+
+template <typename T, MemoryCategory Category>
+class TrackingAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = TrackingAllocator<U, Category>;
+    };
+
+    TrackingAllocator() = default;
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U, Category>& other) {}
+
+    T* allocate(size_t count) {
+        T* result = std::allocator<T>().allocate(count);
+        MemoryTracker::allocate(Category, count * sizeof(T));
+        return result;
+    }
+
+    void deallocate(T* ptr, size_t count) {
+        MemoryTracker::free(Category, count * sizeof(T));
+        std::allocator<T>().deallocate(ptr, count);
+    }
+
+    template <typename U>
+    bool operator == (const TrackingAllocator<U, Category>& other) const { return true; }
+
+    template <typename U>
+    bool operator != (const TrackingAllocator<U, Category>& other) const { return false; }
+};
@@ -2,11 +2,15 @@
 #include <iostream>
 #include <chrono>
 #include <cctype>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
 struct Argument {
     bool valid;
     std::string name;
     std::string value;
+    std::string rawValue;
 };
 
 Argument parseArgument(const std::string& arg) {
@@ -35,6 +39,9 @@ Argument parseArgument(const std::string& arg) {
         argument.value = arg.substr(equals + 1);
     }
 
+    //paths keep their case
+    argument.rawValue = argument.value;
+
     for (char& c : argument.name) {
         c = std::tolower(c);
     }
@@ -79,8 +86,9 @@ void parseSize(Options& options, const std::string& size) {
         return;
     }
 
-    if (width > 4096 || height > 4096) {
-        argumentError(options, "Width and height must be be less than or equal to 4096");
+    //sizes beyond the device's texture limit are drawn by the tiled renderer
+    if (width > 32768 || height > 32768) {
+        argumentError(options, "Width and height must be be less than or equal to 32768");
         return;
     }
 
@@ -88,12 +96,23 @@ void parseSize(Options& options, const std::string& size) {
 }
 
 int32_t getBitDepth(glm::ivec2 size) {
-    int32_t area = size.x * size.y;
-    double bitDepth = std::ceil(std::log2(area) / 3);
-    return static_cast<int32_t>(bitDepth);
+    int64_t area = static_cast<int64_t>(size.x) * size.y;
+    double bitDepth = std::ceil(std::log2(static_cast<double>(area)) / 3);
+    //colors are 8 bits per channel, so large images reuse colors instead
+    return std::min(static_cast<int32_t>(bitDepth), 8);
 }
 
 Options parseArguments(int argc, char** argv) {
+    std::vector<std::string> arguments;
+
+    for (int i = 1; i < argc; i++) {
+        arguments.push_back(argv[i]);
+    }
+
+    return parseArguments(arguments);
+}
+
+Options parseArguments(const std::vector<std::string>& arguments) {
     Options options = {
         true,
         GeneratorType::Shader,
@@ -103,16 +122,37 @@ Options parseArguments(int argc, char** argv) {
         32, false,
         64,
         1024,
+        2,
+        false,
+        0.25f,
+        false,
+        "",
+        false,
+        0,
+        false,
         static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()),
-        Source::Shuffle
+        Source::Shuffle,
+        Metric::RGB,
+        "",
+        "",
+        "",
+        0,
+        "",
+        0,
+        FrameFormat::PNG,
+        1
     };
 
+    if (const char* shaderDirectory = std::getenv("VKCOLORS_SHADER_DIR")) {
+        options.shaderDirectory = shaderDirectory;
+    }
+
     bool userDepth = false;
     bool userMaxBatchAbsolute = false;
     bool userMaxBatchRelative = false;
+    bool userFrameFormat = false;
 
-    for (int i = 1; i < argc; i++) {
-        std::string arg = argv[i];
+    for (auto& arg : arguments) {
         Argument argument = parseArgument(arg);
 
         if (!argument.valid) {
@@ -185,6 +225,110 @@ Options parseArguments(int argc, char** argv) {
             catch (...) {
                 argumentError(options, "Unable to parse max batch relative");
             }
+        } else if (argument.name == "framesinflight" || argument.name == "frames-in-flight") {
+            try {
+                options.framesInFlight = std::stoul(argument.value);
+            }
+            catch (...) {
+                argumentError(options, "Unable to parse frames in flight");
+            }
+
+            if (options.framesInFlight < 1 || options.framesInFlight > 16) {
+                argumentError(options, "Frames in flight must be between 1 and 16");
+            }
+        } else if (argument.name == "adaptivebatch") {
+            options.adaptiveBatch = true;
+        } else if (argument.name == "collisionceiling") {
+            try {
+                options.collisionCeiling = std::stof(argument.value);
+            }
+            catch (...) {
+                argumentError(options, "Unable to parse collision ceiling");
+            }
+
+            if (options.collisionCeiling < 0.0f || options.collisionCeiling > 1.0f) {
+                argumentError(options, "Collision ceiling must be between 0 and 1");
+            }
+        } else if (argument.name == "prewarmcache") {
+            options.prewarmCache = true;
+        } else if (argument.name == "shaderdir") {
+            if (argument.rawValue.empty()) {
+                argumentError(options, "Must specify shader directory");
+            }
+
+            options.shaderDirectory = argument.rawValue;
+        } else if (argument.name == "headless") {
+            options.headless = true;
+        } else if (argument.name == "maxfps") {
+            try {
+                options.maxFps = std::stoul(argument.value);
+            }
+            catch (...) {
+                argumentError(options, "Unable to parse max fps");
+            }
+        } else if (argument.name == "tiled") {
+            options.tiled = true;
+        } else if (argument.name == "jobs") {
+            if (argument.rawValue.empty()) {
+                argumentError(options, "Must specify job file");
+            }
+
+            options.jobs = argument.rawValue;
+        } else if (argument.name == "output") {
+            if (argument.rawValue.empty()) {
+                argumentError(options, "Must specify output file");
+            }
+
+            options.output = argument.rawValue;
+        } else if (argument.name == "memoryreport" || argument.name == "memory-report") {
+            if (argument.rawValue.empty()) {
+                argumentError(options, "Must specify memory report file");
+            }
+
+            options.memoryReport = argument.rawValue;
+        } else if (argument.name == "samplesize" || argument.name == "sample-size") {
+            try {
+                options.sampleSize = std::stoul(argument.value);
+            }
+            catch (...) {
+                argumentError(options, "Unable to parse sample size");
+            }
+        } else if (argument.name == "frames") {
+            if (argument.rawValue.empty()) {
+                argumentError(options, "Must specify frame directory");
+            }
+
+            options.frames = argument.rawValue;
+        } else if (argument.name == "frameevery" || argument.name == "frame-every") {
+            try {
+                options.frameEvery = std::stoul(argument.value);
+            }
+            catch (...) {
+                argumentError(options, "Unable to parse frame interval");
+            }
+        } else if (argument.name == "frameformat" || argument.name == "frame-format") {
+            if (argument.value == "png") {
+                options.frameFormat = FrameFormat::PNG;
+            } else if (argument.value == "qoi") {
+                options.frameFormat = FrameFormat::QOI;
+            } else if (argument.value == "y4m") {
+                options.frameFormat = FrameFormat::Y4M;
+            } else {
+                argumentError(options, "Frame format must be 'png', 'qoi', or 'y4m'");
+            }
+
+            userFrameFormat = true;
+        } else if (argument.name == "radius") {
+            try {
+                options.radius = std::stoul(argument.value);
+            }
+            catch (...) {
+                argumentError(options, "Unable to parse radius");
+            }
+
+            if (options.radius < 1 || options.radius > MAX_RADIUS) {
+                argumentError(options, "Radius must be between 1 and " + std::to_string(MAX_RADIUS));
+            }
         } else if (argument.name == "seed") {
             try {
                 options.seed = std::stoul(argument.value);
@@ -200,11 +344,38 @@ Options parseArguments(int argc, char** argv) {
             } else {
                 argumentError(options, "Unable to parse color source");
             }
+        } else if (argument.name == "metric") {
+            if (argument.value == "rgb") {
+                options.metric = Metric::RGB;
+            } else if (argument.value == "lab") {
+                options.metric = Metric::Lab;
+            } else {
+                argumentError(options, "Metric must be 'rgb' or 'lab'");
+            }
         } else {
             std::cout << "Error: Could not parse argument '" << argument.name << "'\n";
             options.valid = false;
         }
     }
 
+    //only a video can be streamed
+    if (options.frames == "-") {
+        if (options.frameFormat == FrameFormat::PNG && !userFrameFormat) {
+            options.frameFormat = FrameFormat::Y4M;
+        } else if (options.frameFormat != FrameFormat::Y4M) {
+            argumentError(options, "Only 'y4m' frames can be written to stdout");
+        }
+    }
+
+    //the closest neighbor is not a running total, so wave keeps the 3x3 ring
+    if (options.radius > 1 && (options.generator == GeneratorType::CPUWave
+        || (options.generator == GeneratorType::Shader && options.shader == "shaders/wave.comp.spv"))) {
+        argumentError(options, "Radius is only used by 'coral' and 'cpu-coral'");
+    }
+
+    if (options.sampleSize > 0 && options.generator == GeneratorType::Shader) {
+        argumentError(options, "Sample size is only used by 'cpu-wave' and 'cpu-coral'");
+    }
+
     return options;
 }
\ No newline at end of file
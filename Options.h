@@ -3,11 +3,25 @@
 #include <vector>
 #include <glm/glm.hpp>
 
+//largest neighborhood radius the coral generators score
+#define MAX_RADIUS 16
+
 enum class Source {
     Shuffle,
     Hue
 };
 
+enum class Metric {
+    RGB,
+    Lab
+};
+
+enum class FrameFormat {
+    PNG,
+    QOI,
+    Y4M
+};
+
 enum class GeneratorType {
     Shader,
     CPUWave,
@@ -24,8 +38,26 @@ struct Options {
     bool userWorkGroupSize;
     uint32_t maxBatchAbsolute;
     uint32_t maxBatchRelative;
+    uint32_t framesInFlight;
+    bool adaptiveBatch;
+    float collisionCeiling;
+    bool prewarmCache;
+    std::string shaderDirectory;
+    bool headless;
+    uint32_t maxFps;
+    bool tiled;
     uint32_t seed;
     Source source;
+    Metric metric;
+    std::string jobs;
+    std::string output;
+    std::string memoryReport;
+    uint32_t sampleSize;
+    std::string frames;
+    uint32_t frameEvery;
+    FrameFormat frameFormat;
+    uint32_t radius;
 };
 
-Options parseArguments(int argc, char** argv);
\ No newline at end of file
+Options parseArguments(int argc, char** argv);
+Options parseArguments(const std::vector<std::string>& arguments);
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "Profiler.h"
+#include <iostream>
+#include <iomanip>
+
+#define AVERAGE_WEIGHT 0.05
+
+Profiler::Profiler(Core& core, uint32_t queueFamilyIndex, uint32_t slots, const std::vector<std::string>& stages) : m_written(slots) {
+    m_device = core.device().handle();
+    m_slots = slots;
+    m_queriesPerSlot = static_cast<uint32_t>(stages.size()) + 1;
+    m_period = core.timestampPeriod();
+
+    for (auto& written : m_written) {
+        written.store(0, std::memory_order_relaxed);
+    }
+
+    m_results.resize(m_queriesPerSlot);
+    m_mutex = std::make_unique<std::mutex>();
+
+    for (auto& name : stages) {
+        m_stages.push_back({ name, 0.0, 0.0, 0.0, 0 });
+    }
+
+    //queues without timestamp support leave the profiler disabled
+    uint32_t validBits = core.timestampValidBits(queueFamilyIndex);
+    if (validBits == 0) return;
+    m_mask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    VkQueryPoolCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = m_slots * m_queriesPerSlot;
+
+    VKW_CHECK(vkCreateQueryPool(m_device, &info, nullptr, &m_queryPool));
+}
+
+Profiler::~Profiler() {
+    vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+}
+
+void Profiler::begin(vk::CommandBuffer& commandBuffer, uint32_t slot) {
+    if (!enabled() || slot >= m_slots) return;
+
+    uint32_t first = slot * m_queriesPerSlot;
+    vkCmdResetQueryPool(commandBuffer.handle(), m_queryPool, first, m_queriesPerSlot);
+    vkCmdWriteTimestamp(commandBuffer.handle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, first);
+    m_written[slot].store(1, std::memory_order_release);
+}
+
+void Profiler::mark(vk::CommandBuffer& commandBuffer, uint32_t slot, uint32_t stage) {
+    if (!enabled() || slot >= m_slots) return;
+
+    vkCmdWriteTimestamp(commandBuffer.handle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, slot * m_queriesPerSlot + stage + 1);
+}
+
+double Profiler::collect(uint32_t slot) {
+    if (!enabled() || slot >= m_slots || m_written[slot].exchange(0, std::memory_order_acquire) == 0) return 0.0;
+
+    //only called once the slot's work has completed, so this never waits
+    VkResult result = vkGetQueryPoolResults(m_device, m_queryPool, slot * m_queriesPerSlot, m_queriesPerSlot,
+        m_results.size() * sizeof(uint64_t), m_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) return 0.0;
+
+    std::lock_guard<std::mutex> lock(*m_mutex);
+
+    for (size_t i = 0; i < m_stages.size(); i++) {
+        uint64_t ticks = (m_results[i + 1] - m_results[i]) & m_mask;
+        double ms = ticks * m_period / 1000000.0;
+
+        auto& stage = m_stages[i];
+        stage.last = ms;
+        stage.average = stage.samples == 0 ? ms : stage.average * (1.0 - AVERAGE_WEIGHT) + ms * AVERAGE_WEIGHT;
+        stage.total += ms;
+        stage.samples++;
+    }
+
+    return ((m_results.back() - m_results.front()) & m_mask) * m_period / 1000000.0;
+}
+
+std::vector<ProfilerStage> Profiler::stages() {
+    std::lock_guard<std::mutex> lock(*m_mutex);
+    return m_stages;
+}
+
+double Profiler::averageTotal() {
+    std::lock_guard<std::mutex> lock(*m_mutex);
+
+    double total = 0.0;
+    for (auto& stage : m_stages) {
+        total += stage.average;
+    }
+
+    return total;
+}
+
+void Profiler::printSummary(const std::string& name) {
+    if (!enabled()) return;
+
+    auto stages = this->stages();
+    if (stages.size() == 0 || stages[0].samples == 0) return;
+
+    std::cout << std::setprecision(3) << std::fixed;
+    std::cout << name << " GPU time (" << stages[0].samples << " samples):\n";
+
+    for (auto& stage : stages) {
+        std::cout << "  " << stage.name << ": " << stage.total / stage.samples << " ms mean, "
+            << stage.average << " ms recent, " << stage.total << " ms total\n";
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include "Core.h"
+
+struct ProfilerStage {
+    std::string name;
+    double last;
+    double average;
+    double total;
+    uint64_t samples;
+};
+
+//GPU timestamps around the stages of a command buffer, one set of queries per frame slot
+class Profiler {
+public:
+    Profiler(Core& core, uint32_t queueFamilyIndex, uint32_t slots, const std::vector<std::string>& stages);
+    Profiler(const Profiler& other) = delete;
+    Profiler& operator = (const Profiler& other) = delete;
+    ~Profiler();
+
+    void begin(vk::CommandBuffer& commandBuffer, uint32_t slot);
+    void mark(vk::CommandBuffer& commandBuffer, uint32_t slot, uint32_t stage);
+    //returns the slot's GPU time from the first to the last timestamp in ms, or 0 without results
+    double collect(uint32_t slot);
+
+    bool enabled() const { return m_queryPool != VK_NULL_HANDLE; }
+    std::vector<ProfilerStage> stages();
+    double averageTotal();
+    void printSummary(const std::string& name);
+
+private:
+    VkDevice m_device;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    uint32_t m_slots;
+    uint32_t m_queriesPerSlot;
+    double m_period;
+    uint64_t m_mask;
+    //set by the submitting thread, cleared by the one collecting
+    std::vector<std::atomic<uint8_t>> m_written;
+    std::vector<uint64_t> m_results;
+    std::unique_ptr<std::mutex> m_mutex;
+    std::vector<ProfilerStage> m_stages;
+};
@@ -1,8 +1,18 @@
 #include "Renderer.h"
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Utilities.h"
 
 #define STAGING_SIZE (64 * 1024 * 1024)
+#define TILE_SIZE 32
+//a tile is uploaded whole once at least 1 / TILE_DENSITY of its pixels changed
+#define TILE_DENSITY 32
+#define STAGE_UPLOAD 0
+#define STAGE_DRAW 1
+//each scroll step zooms by this factor
+#define ZOOM_STEP 1.25f
+#define MIN_ZOOM (1.0f / 1024.0f)
+#define MAX_ZOOM 64.0f
 
 struct Vertex {
     glm::vec3 pos;
@@ -34,18 +44,34 @@ struct Vertex {
     }
 };
 
-Renderer::Renderer(Core& core, Allocator& allocator, glm::ivec2 size, ColorQueue& colorQueue) : m_staging(core, allocator, STAGING_SIZE) {
+Renderer::Renderer(Core& core, Allocator& allocator, glm::ivec2 size, ColorQueue& colorQueue, vk::Image* sharedTexture, bool tiled)
+    : m_staging(core, allocator, STAGING_SIZE),
+    m_bitmap(sharedTexture == nullptr ? size.x : 0, sharedTexture == nullptr ? size.y : 0) {
     m_core = &core;
     m_allocator = &allocator;
     m_queue = &colorQueue;
     m_size = size;
+    m_sharedTexture = sharedTexture;
+    m_tileCount = (m_size + glm::ivec2(TILE_SIZE - 1)) / TILE_SIZE;
+    m_tileCounts.resize(m_tileCount.x * m_tileCount.y);
+    m_tileData.resize(TILE_SIZE * TILE_SIZE);
     m_core->registerObserver(this);
 
     vk::CommandBuffer commandBuffer = m_core->getSingleUseCommandBuffer();
 
     createVertexBuffer(commandBuffer);
     createIndexBuffer(commandBuffer);
-    createTexture(commandBuffer);
+
+    if (tiled) {
+        //the image may be larger than any texture the device supports, so only visible tiles are kept on the GPU
+        m_tileCache = std::make_unique<TileCache>(*m_core, *m_allocator, m_staging, m_bitmap);
+        m_tileCache->initialize(commandBuffer);
+    } else if (m_sharedTexture == nullptr) {
+        createTexture(commandBuffer);
+    } else {
+        m_core->enableComputeSync();
+    }
+
     m_staging.flush(commandBuffer);
 
     m_core->submitSingleUseCommandBuffer(std::move(commandBuffer));
@@ -58,18 +84,43 @@ Renderer::Renderer(Core& core, Allocator& allocator, glm::ivec2 size, ColorQueue
     createPipelineLayout();
     createPipeline();
 
+    //one set of queries per swapchain image, since each image has its own command buffer and fence
+    m_profiler = std::make_unique<Profiler>(*m_core, m_core->graphicsQueueFamilyIndex(), m_core->imageCount(),
+        std::vector<std::string>{ "upload", "draw" });
+
     int32_t wWidth = static_cast<int32_t>(m_core->swapchain().extent().width);
     int32_t wHeight = static_cast<int32_t>(m_core->swapchain().extent().height);
     onResize(wWidth, wHeight);
 }
 
-Renderer::Renderer(Renderer&& other) : m_staging(std::move(other.m_staging)) {
+Renderer::Renderer(Renderer&& other) : m_staging(std::move(other.m_staging)), m_bitmap(std::move(other.m_bitmap)) {
     *this = std::move(other);
 }
 
+Renderer::~Renderer() {
+    //a moved-from renderer has no buffers left, and a shared texture belongs to the generator
+    if (m_vertexBuffer != nullptr) m_allocator->free(m_vertexAlloc);
+    if (m_indexBuffer != nullptr) m_allocator->free(m_indexAlloc);
+    if (m_texture != nullptr) m_allocator->free(m_textureAlloc);
+}
+
 void Renderer::record(vk::CommandBuffer& commandBuffer) {
+    //acquire already waited on this image's fence, so its previous timestamps are available
+    uint32_t slot = m_core->imageIndex();
+    m_profiler->collect(slot);
+    m_profiler->begin(commandBuffer, slot);
+
+    if (m_sharedTexture != nullptr) {
+        //the compute image is already up to date, only the counts need updating
+        m_queue->swap();
+        m_profiler->mark(commandBuffer, slot, STAGE_UPLOAD);
+        draw(commandBuffer);
+        m_profiler->mark(commandBuffer, slot, STAGE_DRAW);
+        return;
+    }
+
     vk::ImageMemoryBarrier barrier = {};
-    barrier.image = m_texture.get();
+    barrier.image = m_tileCache != nullptr ? &m_tileCache->atlas() : m_texture.get();
     barrier.oldLayout = vk::ImageLayout::ShaderReadOnlyOptimal;
     barrier.newLayout = vk::ImageLayout::TransferDstOptimal;
     barrier.srcAccessMask = vk::AccessFlags::ShaderRead;
@@ -85,21 +136,7 @@ void Renderer::record(vk::CommandBuffer& commandBuffer) {
     commandBuffer.pipelineBarrier(vk::PipelineStageFlags::FragmentShader, vk::PipelineStageFlags::Transfer, vk::DependencyFlags::None,
         {}, {}, { barrier });
 
-    auto changes = m_queue->swap();
-    
-    for (auto item : changes) {
-        vk::Extent3D extent = {};
-        extent.width = 1;
-        extent.height = 1;
-        extent.depth = 1;
-    
-        vk::Offset3D offset = {};
-        offset.x = item.pos.x;
-        offset.y = item.pos.y;
-    
-        m_staging.transfer(&item.color, sizeof(Color32), *m_texture, vk::ImageLayout::TransferDstOptimal, extent, offset);
-    }
-
+    uploadChanges();
     m_staging.flush(commandBuffer);
 
     barrier.oldLayout = vk::ImageLayout::TransferDstOptimal;
@@ -107,9 +144,20 @@ void Renderer::record(vk::CommandBuffer& commandBuffer) {
     barrier.srcAccessMask = vk::AccessFlags::TransferWrite;
     barrier.dstAccessMask = vk::AccessFlags::ShaderRead;
 
+    //also covers the page table, which is rewritten whenever a tile moves
+    vk::MemoryBarrier memoryBarrier = {};
+    memoryBarrier.srcAccessMask = vk::AccessFlags::TransferWrite;
+    memoryBarrier.dstAccessMask = vk::AccessFlags::ShaderRead;
+
     commandBuffer.pipelineBarrier(vk::PipelineStageFlags::Transfer, vk::PipelineStageFlags::FragmentShader, vk::DependencyFlags::None,
-        {}, {}, { barrier });
+        { memoryBarrier }, {}, { barrier });
 
+    m_profiler->mark(commandBuffer, slot, STAGE_UPLOAD);
+    draw(commandBuffer);
+    m_profiler->mark(commandBuffer, slot, STAGE_DRAW);
+}
+
+void Renderer::draw(vk::CommandBuffer& commandBuffer) {
     m_core->beginRenderPass(commandBuffer);
 
     commandBuffer.bindVertexBuffers(0, { *m_vertexBuffer }, { 0 });
@@ -122,13 +170,114 @@ void Renderer::record(vk::CommandBuffer& commandBuffer) {
     commandBuffer.endRenderPass();
 }
 
+size_t Renderer::getTileIndex(glm::ivec2 pos) {
+    return (pos.x / TILE_SIZE) + ((pos.y / TILE_SIZE) * m_tileCount.x);
+}
+
+void Renderer::uploadChanges() {
+    auto& changes = m_queue->swap();
+
+    if (m_tileCache != nullptr) {
+        for (auto& item : changes) {
+            m_bitmap.getPixel(item.pos.x, item.pos.y) = item.color;
+            m_tileCache->setPixel(item.pos);
+        }
+
+        glm::vec2 center = m_pan + glm::vec2(m_size) / 2.0f;
+        glm::vec2 extent = m_windowSize / 2.0f / m_zoom;
+        m_tileCache->update(center - extent, center + extent, m_zoom);
+        return;
+    }
+
+    for (auto& item : changes) {
+        m_bitmap.getPixel(item.pos.x, item.pos.y) = item.color;
+
+        size_t tile = getTileIndex(item.pos);
+        if (m_tileCounts[tile] == 0) {
+            m_dirtyTiles.push_back(tile);
+        }
+        m_tileCounts[tile]++;
+    }
+
+    //dense tiles are copied from the mirror as one region, sparse tiles pixel by pixel
+    for (size_t tile : m_dirtyTiles) {
+        glm::ivec2 offset = glm::ivec2{ static_cast<int32_t>(tile % m_tileCount.x), static_cast<int32_t>(tile / m_tileCount.x) } * TILE_SIZE;
+        glm::ivec2 extent = glm::min(glm::ivec2(TILE_SIZE), m_size - offset);
+
+        if (m_tileCounts[tile] * TILE_DENSITY >= static_cast<uint32_t>(extent.x * extent.y)) {
+            uploadTile(offset, extent);
+            m_tileCounts[tile] = 0;
+        }
+    }
+
+    for (auto& item : changes) {
+        if (m_tileCounts[getTileIndex(item.pos)] == 0) continue;
+
+        vk::Extent3D extent = {};
+        extent.width = 1;
+        extent.height = 1;
+        extent.depth = 1;
+
+        vk::Offset3D offset = {};
+        offset.x = item.pos.x;
+        offset.y = item.pos.y;
+
+        m_staging.transfer(&m_bitmap.getPixel(item.pos.x, item.pos.y), sizeof(Color32), *m_texture, vk::ImageLayout::TransferDstOptimal, extent, offset);
+    }
+
+    for (size_t tile : m_dirtyTiles) {
+        m_tileCounts[tile] = 0;
+    }
+
+    m_dirtyTiles.clear();
+}
+
+void Renderer::uploadTile(glm::ivec2 offset, glm::ivec2 extent) {
+    for (int32_t y = 0; y < extent.y; y++) {
+        memcpy(&m_tileData[y * extent.x], &m_bitmap.getPixel(offset.x, offset.y + y), extent.x * sizeof(Color32));
+    }
+
+    vk::Extent3D imageExtent = {};
+    imageExtent.width = static_cast<uint32_t>(extent.x);
+    imageExtent.height = static_cast<uint32_t>(extent.y);
+    imageExtent.depth = 1;
+
+    vk::Offset3D imageOffset = {};
+    imageOffset.x = offset.x;
+    imageOffset.y = offset.y;
+
+    m_staging.transfer(m_tileData.data(), extent.x * extent.y * sizeof(Color32), *m_texture, vk::ImageLayout::TransferDstOptimal, imageExtent, imageOffset);
+}
+
 void Renderer::onResize(int width, int height) {
-    m_projectionMatrix = glm::ortho<float>(-width / 2.0f, width / 2.0f, -height / 2.0f, height / 2.0f, 0, 1);
+    m_windowSize = { static_cast<float>(width), static_cast<float>(height) };
+    updateProjection();
     if (m_pipeline != nullptr) {
         createPipeline();
     }
 }
 
+void Renderer::onScroll(double offset, double x, double y) {
+    //keeps the pixel under the cursor in place
+    glm::vec2 cursor = glm::vec2(static_cast<float>(x), static_cast<float>(y)) - m_windowSize / 2.0f;
+    glm::vec2 point = m_pan + cursor / m_zoom;
+
+    m_zoom = glm::clamp(m_zoom * std::pow(ZOOM_STEP, static_cast<float>(offset)), MIN_ZOOM, MAX_ZOOM);
+    m_pan = point - cursor / m_zoom;
+    updateProjection();
+}
+
+void Renderer::onDrag(double dx, double dy) {
+    m_pan -= glm::vec2(static_cast<float>(dx), static_cast<float>(dy)) / m_zoom;
+    updateProjection();
+}
+
+void Renderer::updateProjection() {
+    glm::mat4 ortho = glm::ortho<float>(-m_windowSize.x / 2.0f, m_windowSize.x / 2.0f, -m_windowSize.y / 2.0f, m_windowSize.y / 2.0f, 0, 1);
+    glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(m_zoom, m_zoom, 1.0f));
+    m_projectionMatrix = glm::translate(ortho * scale, glm::vec3(-m_pan, 0.0f));
+}
+
 void Renderer::createVertexBuffer(vk::CommandBuffer& commandBuffer) {
     std::vector<Vertex> vertices = {
         { { -m_size.x / 2, -m_size.y / 2, 0 }, { 0, 0 } },
@@ -205,8 +354,12 @@ void Renderer::createTexture(vk::CommandBuffer& commandBuffer) {
 
 void Renderer::createTextureView() {
     vk::ImageViewCreateInfo info = {};
-    info.image = m_texture.get();
-    info.format = m_texture->format();
+    if (m_tileCache != nullptr) {
+        info.image = &m_tileCache->atlas();
+    } else {
+        info.image = m_sharedTexture != nullptr ? m_sharedTexture : m_texture.get();
+    }
+    info.format = vk::Format::R8G8B8A8_Unorm;
     info.viewType = vk::ImageViewType::_2D;
     info.subresourceRange.aspectMask = vk::ImageAspectFlags::Color;
     info.subresourceRange.baseArrayLayer = 0;
@@ -239,6 +392,16 @@ void Renderer::createDescriptorLayout() {
     vk::DescriptorSetLayoutCreateInfo info = {};
     info.bindings = { binding };
 
+    if (m_tileCache != nullptr) {
+        vk::DescriptorSetLayoutBinding pageTableBinding = {};
+        pageTableBinding.binding = 1;
+        pageTableBinding.descriptorCount = 1;
+        pageTableBinding.descriptorType = vk::DescriptorType::StorageBuffer;
+        pageTableBinding.stageFlags = vk::ShaderStageFlags::Fragment;
+
+        info.bindings.push_back(pageTableBinding);
+    }
+
     m_descriptorLayout = std::make_unique<vk::DescriptorSetLayout>(m_core->device(), info);
 }
 
@@ -250,7 +413,15 @@ void Renderer::createDescriptorPool() {
     vk::DescriptorPoolCreateInfo info = {};
     info.maxSets = 1;
     info.poolSizes = { poolSize };
-    
+
+    if (m_tileCache != nullptr) {
+        vk::DescriptorPoolSize storageSize = {};
+        storageSize.descriptorCount = 1;
+        storageSize.type = vk::DescriptorType::StorageBuffer;
+
+        info.poolSizes.push_back(storageSize);
+    }
+
     m_descriptorPool = std::make_unique<vk::DescriptorPool>(m_core->device(), info);
 }
 
@@ -264,14 +435,30 @@ void Renderer::createDescriptorSet() {
     vk::DescriptorImageInfo imageInfo = {};
     imageInfo.sampler = m_sampler.get();
     imageInfo.imageView = m_textureView.get();
-    imageInfo.imageLayout = vk::ImageLayout::ShaderReadOnlyOptimal;
+    imageInfo.imageLayout = m_sharedTexture != nullptr ? vk::ImageLayout::General : vk::ImageLayout::ShaderReadOnlyOptimal;
 
     vk::WriteDescriptorSet write = {};
     write.dstSet = m_descriptorSet.get();
     write.descriptorType = vk::DescriptorType::CombinedImageSampler;
     write.imageInfo = { imageInfo };
 
-    vk::DescriptorSet::update(m_core->device(), { write }, {});
+    std::vector<vk::WriteDescriptorSet> writes = { write };
+
+    if (m_tileCache != nullptr) {
+        vk::DescriptorBufferInfo bufferInfo = {};
+        bufferInfo.buffer = &m_tileCache->pageTable();
+        bufferInfo.range = m_tileCache->pageTable().size();
+
+        vk::WriteDescriptorSet pageTableWrite = {};
+        pageTableWrite.dstSet = m_descriptorSet.get();
+        pageTableWrite.dstBinding = 1;
+        pageTableWrite.descriptorType = vk::DescriptorType::StorageBuffer;
+        pageTableWrite.bufferInfo = { bufferInfo };
+
+        writes.push_back(pageTableWrite);
+    }
+
+    vk::DescriptorSet::update(m_core->device(), writes, {});
 }
 
 void Renderer::createPipelineLayout() {
@@ -288,7 +475,7 @@ void Renderer::createPipelineLayout() {
 
 void Renderer::createPipeline() {
     vk::ShaderModule vertShader = loadShader(m_core->device(), "shaders/shader.vert.spv");
-    vk::ShaderModule fragShader = loadShader(m_core->device(), "shaders/shader.frag.spv");
+    vk::ShaderModule fragShader = loadShader(m_core->device(), m_tileCache != nullptr ? "shaders/tiled.frag.spv" : "shaders/shader.frag.spv");
 
     vk::PipelineShaderStageCreateInfo vertInfo = {};
     vertInfo.module = &vertShader;
@@ -348,5 +535,5 @@ void Renderer::createPipeline() {
     info.renderPass = &m_core->renderPass();
     info.subpass = 0;
     
-    m_pipeline = std::make_unique<vk::GraphicsPipeline>(m_core->device(), info);
+    m_pipeline = std::make_unique<vk::GraphicsPipeline>(m_core->device(), info, &m_core->pipelineCache());
 }
\ No newline at end of file
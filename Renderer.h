@@ -6,18 +6,27 @@
 #include "Bitmap.h"
 #include "Staging.h"
 #include "ColorQueue.h"
+#include "Profiler.h"
+#include "TileCache.h"
 
 class Renderer : public Observer {
 public:
-    Renderer(Core& core, Allocator& allocator, glm::ivec2 size, ColorQueue& colorQueue);
+    Renderer(Core& core, Allocator& allocator, glm::ivec2 size, ColorQueue& colorQueue, vk::Image* sharedTexture = nullptr, bool tiled = false);
     Renderer(const Renderer& other) = delete;
     Renderer& operator = (const Renderer& other) = delete;
     Renderer(Renderer&& other);
     Renderer& operator = (Renderer&& other) = default;
+    ~Renderer();
 
     void record(vk::CommandBuffer& commandBuffer);
+    const StagingStats& stagingStats() const { return m_staging.stats(); }
+    //uploads that did not fit in the staging ring still need more frames
+    bool hasPendingUploads() const { return m_staging.hasPending() || (m_tileCache != nullptr && m_tileCache->hasPending()); }
+    Profiler& profiler() { return *m_profiler; }
 
     void onResize(int width, int height);
+    void onScroll(double offset, double x, double y);
+    void onDrag(double dx, double dy);
 
 private:
     Core* m_core;
@@ -25,12 +34,19 @@ private:
     ColorQueue* m_queue;
     Staging m_staging;
     glm::ivec2 m_size;
+    Bitmap m_bitmap;
+    glm::ivec2 m_tileCount;
+    std::vector<uint32_t> m_tileCounts;
+    std::vector<size_t> m_dirtyTiles;
+    std::vector<Color32> m_tileData;
     std::unique_ptr<vk::Buffer> m_vertexBuffer;
     Allocation m_vertexAlloc;
     std::unique_ptr<vk::Buffer> m_indexBuffer;
     Allocation m_indexAlloc;
     std::unique_ptr<vk::Image> m_texture;
     Allocation m_textureAlloc;
+    vk::Image* m_sharedTexture;
+    std::unique_ptr<TileCache> m_tileCache;
     std::unique_ptr<vk::ImageView> m_textureView;
     std::unique_ptr<vk::Sampler> m_sampler;
     std::unique_ptr<vk::DescriptorSetLayout> m_descriptorLayout;
@@ -39,6 +55,11 @@ private:
     std::unique_ptr<vk::PipelineLayout> m_pipelineLayout;
     std::unique_ptr<vk::Pipeline> m_pipeline;
     glm::mat4 m_projectionMatrix;
+    glm::vec2 m_windowSize;
+    //image space offset of the window center from the image center
+    glm::vec2 m_pan = {};
+    float m_zoom = 1.0f;
+    std::unique_ptr<Profiler> m_profiler;
 
     void createVertexBuffer(vk::CommandBuffer& commandBuffer);
     void createIndexBuffer(vk::CommandBuffer& commandBuffer);
@@ -50,4 +71,10 @@ private:
     void createDescriptorSet();
     void createPipelineLayout();
     void createPipeline();
+
+    void updateProjection();
+    void draw(vk::CommandBuffer& commandBuffer);
+    size_t getTileIndex(glm::ivec2 pos);
+    void uploadChanges();
+    void uploadTile(glm::ivec2 offset, glm::ivec2 extent);
 };
\ No newline at end of file
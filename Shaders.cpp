@@ -0,0 +1,31 @@
+#include "Shaders.h"
+#include <cstring>
+#include <stdexcept>
+#include "Utilities.h"
+
+static std::string shaderDirectory;
+
+void setShaderDirectory(const std::string& directory) {
+    shaderDirectory = directory;
+}
+
+std::vector<char> getShaderCode(const std::string& name) {
+    if (!shaderDirectory.empty()) {
+        size_t slash = name.find_last_of("/\\");
+        std::string file = slash == std::string::npos ? name : name.substr(slash + 1);
+        return loadFile(shaderDirectory + "/" + file);
+    }
+
+    for (size_t i = 0; i < embeddedShaderCount; i++) {
+        const EmbeddedShader& shader = embeddedShaders[i];
+
+        if (name == shader.name) {
+            std::vector<char> code(shader.size);
+            memcpy(code.data(), shader.code, shader.size);
+            return code;
+        }
+    }
+
+    //not built into the binary, so it has to be on disk
+    return loadFile(name);
+}
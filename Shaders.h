@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct EmbeddedShader {
+    const char* name;
+    const uint32_t* code;
+    size_t size;
+};
+
+//generated by the build from every compiled shader, named like "shaders/coral.comp.spv"
+extern const EmbeddedShader embeddedShaders[];
+extern const size_t embeddedShaderCount;
+
+//shaders are read from this directory instead of the binary when it is set, for editing shaders without rebuilding
+void setShaderDirectory(const std::string& directory);
+std::vector<char> getShaderCode(const std::string& name);
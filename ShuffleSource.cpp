@@ -1,24 +1,23 @@
 #include "ShuffleSource.h"
-#include <math.h>
 #include <random>
 
-ShuffleSource::ShuffleSource(const Options& options) {
-    std::vector<Color32> colors;
-    uint32_t bitDepth = options.bitDepth;
-
-    uint32_t max = static_cast<uint32_t>(pow(2, bitDepth));
-    for (uint32_t r = 0; r < max; r++) {
-        for (uint32_t g = 0; g < max; g++) {
-            for (uint32_t b = 0; b < max; b++) {
-                Color32 color = { map(r, bitDepth), map(g, bitDepth), map(b, bitDepth), 255 };
-                colors.push_back(color);
-            }
-        }
-    }
+ShuffleSource::ShuffleSource(const Options& options) : ShuffleSource(createPalette(options)) {}
+
+ShuffleSource::ShuffleSource(Palette palette) {
+    m_palette = std::move(palette);
+}
+
+Palette ShuffleSource::createPalette(const Options& options) {
+    return shuffle(*createColors(options.bitDepth), options.seed);
+}
+
+Palette ShuffleSource::shuffle(const PaletteColors& source, uint32_t seed) {
+    auto palette = std::make_shared<PaletteColors>(source);
+    auto& colors = *palette;
 
     //fisher yates shuffle
     std::default_random_engine random;
-    random.seed(options.seed);
+    random.seed(seed);
 
     for (size_t i = colors.size() - 1; i >= 1; i--) {
         std::uniform_int_distribution<size_t> dist(0, i);
@@ -26,9 +25,7 @@ ShuffleSource::ShuffleSource(const Options& options) {
         std::swap(colors[i], colors[j]);
     }
 
-    for (Color32 color : colors) {
-        m_colors.push(color);
-    }
+    return palette;
 }
 
 ShuffleSource::ShuffleSource(ShuffleSource&& other) {
@@ -36,15 +33,20 @@ ShuffleSource::ShuffleSource(ShuffleSource&& other) {
 }
 
 bool ShuffleSource::hasNext() {
-    return m_colors.size() > 0;
+    return m_next < m_palette->size() || m_resubmitted.size() > 0;
 }
 
 Color32 ShuffleSource::getNext() {
-    auto result = m_colors.front();
-    m_colors.pop();
+    if (m_next < m_palette->size()) {
+        return (*m_palette)[m_next++];
+    }
+
+    auto result = m_resubmitted.front();
+    m_resubmitted.pop_front();
     return result;
 }
 
+//resubmitted colors go to the back, after the rest of the palette
 void ShuffleSource::resubmit(Color32 color) {
-    m_colors.push(color);
+    m_resubmitted.push_back(color);
 }
\ No newline at end of file
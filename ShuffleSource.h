@@ -1,10 +1,11 @@
 #include "ColorSource.h"
-#include <queue>
+#include <deque>
 #include "Options.h"
 
 class ShuffleSource : public ColorSource {
 public:
     ShuffleSource(const Options& options);
+    ShuffleSource(Palette palette);
     ShuffleSource(const ShuffleSource& other) = delete;
     ShuffleSource& operator = (const ShuffleSource& other) = delete;
     ShuffleSource(ShuffleSource&& other);
@@ -14,6 +15,12 @@ public:
     Color32 getNext();
     void resubmit(Color32 color);
 
+    static Palette createPalette(const Options& options);
+    //a copy of the colors in the order of the seed
+    static Palette shuffle(const PaletteColors& colors, uint32_t seed);
+
 private:
-    std::queue<Color32> m_colors;
+    Palette m_palette;
+    size_t m_next = 0;
+    std::deque<Color32, TrackingAllocator<Color32, MemoryCategory::Palette>> m_resubmitted;
 };
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "Staging.h"
 #include "Utilities.h"
+#include <algorithm>
 
 Staging::Staging(Core& core, Allocator& allocator, size_t size) {
     m_core = &core;
     m_allocator = &allocator;
+    m_size = size;
+    m_stats.capacity = size;
 
     createStagingMemory(size);
 }
@@ -26,10 +29,11 @@ void Staging::createStagingMemory(size_t size) {
 }
 
 void Staging::transfer(void* data, size_t size, vk::Buffer& dstBuffer) {
-    size_t offset = align(ptr, 4);
-    memcpy(static_cast<char*>(m_mapping) + offset, data, size);
-    m_data.emplace_back(StagingData{ offset, size, &dstBuffer });
-    ptr = offset + size;
+    StagingData transfer = {};
+    transfer.size = size;
+    transfer.dstBuffer = &dstBuffer;
+
+    queueTransfer(static_cast<const char*>(data), transfer);
 }
 
 void Staging::transfer(void* data, size_t size, vk::Image& dstImage, vk::ImageLayout imageLayout) {
@@ -37,21 +41,139 @@ void Staging::transfer(void* data, size_t size, vk::Image& dstImage, vk::ImageLa
 }
 
 void Staging::transfer(void* data, size_t size, vk::Image& dstImage, vk::ImageLayout imageLayout, vk::Extent3D extent, vk::Offset3D offset) {
-    size_t bufferOffset = align(ptr, 4);
-    memcpy(static_cast<char*>(m_mapping) + bufferOffset, data, size);
-    m_data.emplace_back(StagingData{ bufferOffset, size, nullptr, &dstImage, imageLayout, extent, offset });
-    ptr = bufferOffset + size;
+    StagingData transfer = {};
+    transfer.size = size;
+    transfer.dstImage = &dstImage;
+    transfer.imageLayout = imageLayout;
+    transfer.imageExtent = extent;
+    transfer.imageOffset = offset;
+
+    queueTransfer(static_cast<const char*>(data), transfer);
+}
+
+void Staging::queueTransfer(const char* data, StagingData transfer) {
+    m_stats.transferred += transfer.size;
+
+    //anything queued behind a deferred transfer must wait as well, to keep writes in order
+    if (m_pending.size() == 0) {
+        data += stage(data, transfer);
+        if (transfer.size == 0) return;
+    }
+
+    PendingTransfer pending = {};
+    pending.data = transfer;
+    pending.bytes.assign(data, data + transfer.size);
+    m_pending.emplace_back(std::move(pending));
+
+    m_stats.deferred += transfer.size;
+}
+
+size_t Staging::stage(const char* data, StagingData& transfer) {
+    //images are split on row boundaries, buffers anywhere
+    size_t unit = 1;
+    if (transfer.dstImage != nullptr) {
+        unit = transfer.size / transfer.imageExtent.height;
+    }
+
+    size_t units = transfer.size / unit;
+    size_t offset = 0;
+
+    while (units > 0 && !allocate(units * unit, offset)) {
+        units /= 2;
+    }
+
+    if (units == 0) return 0;
+
+    size_t size = units * unit;
+    memcpy(static_cast<char*>(m_mapping) + offset, data, size);
+
+    StagingData staged = transfer;
+    staged.offset = offset;
+    staged.size = size;
+
+    if (transfer.dstImage != nullptr) {
+        staged.imageExtent.height = static_cast<uint32_t>(units);
+        transfer.imageExtent.height -= static_cast<uint32_t>(units);
+        transfer.imageOffset.y += static_cast<int32_t>(units);
+    } else {
+        transfer.dstOffset += size;
+    }
+
+    transfer.size -= size;
+    m_data.push_back(staged);
+
+    if (transfer.size > 0) {
+        m_stats.splits++;
+    }
+
+    return size;
+}
+
+bool Staging::allocate(size_t size, size_t& offset) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t start = align(m_head, 4);
+        size_t padding = start - m_head;
+
+        if (start + size > m_size) {
+            //skip the end of the buffer and wrap around
+            start = 0;
+            padding = m_size - m_head;
+        }
+
+        if (m_used + padding + size <= m_size) {
+            offset = start;
+            m_head = start + size;
+            m_used += padding + size;
+            m_frameSize += padding + size;
+            m_stats.highWater = std::max(m_stats.highWater, m_used);
+            return true;
+        }
+
+        reclaim();
+    }
+
+    return false;
+}
+
+void Staging::reclaim() {
+    while (m_frames.size() > 0 && m_core->isFrameComplete(m_frames.front().frame)) {
+        m_used -= m_frames.front().size;
+        m_frames.pop_front();
+    }
+
+    if (m_used == 0) {
+        m_head = 0;
+    }
 }
 
 void Staging::flush(vk::CommandBuffer& commandBuffer) {
+    reclaim();
+
+    while (m_pending.size() > 0) {
+        auto& pending = m_pending.front();
+        pending.consumed += stage(pending.bytes.data() + pending.consumed, pending.data);
+
+        if (pending.data.size > 0) break;
+        m_pending.pop_front();
+    }
+
+    StagingData* regionTarget = nullptr;
+
     for (auto& transfer : m_data) {
         if (transfer.dstBuffer != nullptr) {
             vk::BufferCopy copy = {};
             copy.size = transfer.size;
             copy.srcOffset = transfer.offset;
+            copy.dstOffset = transfer.dstOffset;
 
             commandBuffer.copyBuffer(*m_buffer, *transfer.dstBuffer, copy);
         } else if (transfer.dstImage != nullptr) {
+            //consecutive copies into the same image are submitted as one command with many regions
+            if (regionTarget != nullptr
+                && (regionTarget->dstImage != transfer.dstImage || regionTarget->imageLayout != transfer.imageLayout)) {
+                flushRegions(commandBuffer, *regionTarget);
+            }
+
             vk::BufferImageCopy copy = {};
             copy.bufferOffset = transfer.offset;
             copy.imageOffset = transfer.imageOffset;
@@ -61,10 +183,27 @@ void Staging::flush(vk::CommandBuffer& commandBuffer) {
             copy.imageSubresource.layerCount = 1;
             copy.imageSubresource.mipLevel = 0;
 
-            commandBuffer.copyBufferToImage(*m_buffer, *transfer.dstImage, transfer.imageLayout, { copy });
+            m_regions.push_back(copy);
+            regionTarget = &transfer;
         }
     }
 
+    if (regionTarget != nullptr) {
+        flushRegions(commandBuffer, *regionTarget);
+    }
+
     m_data.clear();
-    ptr = 0;
+
+    //this frame's data is only released once the frame that reads it has finished
+    if (m_frameSize > 0) {
+        m_frames.push_back({ m_core->frameNumber(), m_frameSize });
+        m_frameSize = 0;
+    }
+}
+
+void Staging::flushRegions(vk::CommandBuffer& commandBuffer, StagingData& transfer) {
+    if (m_regions.size() == 0) return;
+
+    commandBuffer.copyBufferToImage(*m_buffer, *transfer.dstImage, transfer.imageLayout, m_regions);
+    m_regions.clear();
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include <deque>
+#include "MemoryTracker.h"
 #include "Allocator.h"
 
 struct StagingData {
@@ -9,9 +11,29 @@ struct StagingData {
     vk::ImageLayout imageLayout;
     vk::Extent3D imageExtent;
     vk::Offset3D imageOffset;
+    size_t dstOffset;
+};
+
+struct StagingStats {
+    size_t capacity;
+    size_t highWater;
+    size_t transferred;
+    size_t deferred;
+    size_t splits;
 };
 
 class Staging {
+    struct FrameRegion {
+        uint64_t frame;
+        size_t size;
+    };
+
+    struct PendingTransfer {
+        StagingData data;
+        std::vector<char, TrackingAllocator<char, MemoryCategory::Staging>> bytes;
+        size_t consumed;
+    };
+
 public:
     Staging(Core& core, Allocator& allocator, size_t size);
     Staging(const Staging& other) = delete;
@@ -24,14 +46,29 @@ public:
     void transfer(void* data, size_t size, vk::Image& dstImage, vk::ImageLayout imageLayout, vk::Extent3D extent, vk::Offset3D offset);
     void flush(vk::CommandBuffer& commandBuffer);
 
+    const StagingStats& stats() const { return m_stats; }
+    bool hasPending() const { return !m_pending.empty(); }
+
 private:
     Core* m_core;
     Allocator* m_allocator;
     Allocation m_alloc;
-    size_t ptr = 0;
+    size_t m_size;
+    size_t m_head = 0;
+    size_t m_used = 0;
+    size_t m_frameSize = 0;
     std::unique_ptr<vk::Buffer> m_buffer;
     void* m_mapping;
     std::vector<StagingData> m_data;
+    std::vector<vk::BufferImageCopy> m_regions;
+    std::deque<FrameRegion> m_frames;
+    std::deque<PendingTransfer> m_pending;
+    StagingStats m_stats = {};
 
     void createStagingMemory(size_t size);
+    void queueTransfer(const char* data, StagingData transfer);
+    size_t stage(const char* data, StagingData& transfer);
+    bool allocate(size_t size, size_t& offset);
+    void reclaim();
+    void flushRegions(vk::CommandBuffer& commandBuffer, StagingData& transfer);
 };
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "TileCache.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+//tiles streamed per frame, so panning into a new area does not stall a single frame
+#define TILE_UPLOADS_PER_FRAME 32
+
+struct PageTableHeader {
+    glm::uvec2 imageSize;
+    uint32_t levels;
+    uint32_t tileSize;
+    uint32_t slotsPerRow;
+    uint32_t padding[3];
+    glm::uvec4 levelInfo[TILE_CACHE_MAX_LEVELS];
+};
+
+TileCache::TileCache(Core& core, Allocator& allocator, Staging& staging, Bitmap& bitmap) {
+    m_core = &core;
+    m_allocator = &allocator;
+    m_staging = &staging;
+    m_bitmap = &bitmap;
+    m_size = { static_cast<int32_t>(bitmap.width()), static_cast<int32_t>(bitmap.height()) };
+    m_slots.resize(TILE_CACHE_SLOTS * TILE_CACHE_SLOTS, { -1, 0 });
+    m_tileData.resize(TILE_CACHE_TILE_SIZE * TILE_CACHE_TILE_SIZE);
+
+    createLevels();
+    createAtlas();
+    createPageTable();
+}
+
+TileCache::~TileCache() {
+    m_allocator->free(m_atlasAlloc);
+    m_allocator->free(m_pageTableAlloc);
+}
+
+void TileCache::createLevels() {
+    glm::ivec2 size = m_size;
+    uint32_t offset = 0;
+
+    //each level halves the previous one, until the whole image fits in one tile
+    while (true) {
+        glm::ivec2 tiles = (size + glm::ivec2(TILE_CACHE_TILE_SIZE - 1)) / TILE_CACHE_TILE_SIZE;
+        bool first = m_levels.empty();
+
+        m_levels.push_back({ size, tiles, offset, Bitmap(first ? 0 : size.x, first ? 0 : size.y) });
+        offset += static_cast<uint32_t>(tiles.x * tiles.y);
+
+        if (tiles.x == 1 && tiles.y == 1) break;
+        if (m_levels.size() == TILE_CACHE_MAX_LEVELS) break;
+        size = (size + glm::ivec2(1)) / 2;
+    }
+
+    m_entries.resize(offset);
+    m_dirty.resize(offset);
+}
+
+void TileCache::createAtlas() {
+    vk::ImageCreateInfo info = {};
+    info.extent.width = TILE_CACHE_SLOTS * TILE_CACHE_TILE_SIZE;
+    info.extent.height = TILE_CACHE_SLOTS * TILE_CACHE_TILE_SIZE;
+    info.extent.depth = 1;
+    info.format = vk::Format::R8G8B8A8_Unorm;
+    info.initialLayout = vk::ImageLayout::Undefined;
+    info.arrayLayers = 1;
+    info.mipLevels = 1;
+    info.imageType = vk::ImageType::_2D;
+    info.samples = vk::SampleCountFlags::_1;
+    info.usage = vk::ImageUsageFlags::Sampled | vk::ImageUsageFlags::TransferDst;
+
+    m_atlas = std::make_unique<vk::Image>(m_core->device(), info);
+
+    m_atlasAlloc = m_allocator->allocate(m_atlas->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::DeviceLocal);
+    m_atlas->bind(*m_atlasAlloc.memory, m_atlasAlloc.offset);
+}
+
+void TileCache::createPageTable() {
+    m_tableData.resize(sizeof(PageTableHeader) + m_entries.size() * sizeof(uint32_t));
+
+    vk::BufferCreateInfo info = {};
+    info.size = m_tableData.size();
+    info.usage = vk::BufferUsageFlags::StorageBuffer | vk::BufferUsageFlags::TransferDst;
+
+    m_pageTableBuffer = std::make_unique<vk::Buffer>(m_core->device(), info);
+
+    m_pageTableAlloc = m_allocator->allocate(m_pageTableBuffer->requirements(), vk::MemoryPropertyFlags::DeviceLocal, vk::MemoryPropertyFlags::DeviceLocal);
+    m_pageTableBuffer->bind(*m_pageTableAlloc.memory, m_pageTableAlloc.offset);
+}
+
+void TileCache::initialize(vk::CommandBuffer& commandBuffer) {
+    vk::ImageMemoryBarrier barrier = {};
+    barrier.image = m_atlas.get();
+    barrier.oldLayout = vk::ImageLayout::Undefined;
+    barrier.newLayout = vk::ImageLayout::ShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlags::None;
+    barrier.dstAccessMask = vk::AccessFlags::ShaderRead;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = vk::ImageAspectFlags::Color;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlags::TopOfPipe, vk::PipelineStageFlags::FragmentShader, vk::DependencyFlags::None,
+        {}, {}, { barrier });
+
+    uploadPageTable();
+}
+
+Color32 TileCache::getPixel(size_t level, glm::ivec2 pos) {
+    if (level == 0) return m_bitmap->getPixel(pos.x, pos.y);
+    return m_levels[level].bitmap.getPixel(pos.x, pos.y);
+}
+
+void TileCache::setPixel(glm::ivec2 pos) {
+    m_dirty[(pos.x / TILE_CACHE_TILE_SIZE) + (pos.y / TILE_CACHE_TILE_SIZE) * m_levels[0].tiles.x] = true;
+
+    //only the parents of a changed pixel are recomputed, so the pyramid costs a few reads per placement
+    for (size_t i = 1; i < m_levels.size(); i++) {
+        auto& level = m_levels[i];
+        auto& below = m_levels[i - 1];
+        pos /= 2;
+
+        uint32_t sum[3] = {};
+        uint32_t count = 0;
+
+        for (int32_t y = 0; y < 2; y++) {
+            for (int32_t x = 0; x < 2; x++) {
+                glm::ivec2 child = pos * 2 + glm::ivec2(x, y);
+                if (child.x >= below.size.x || child.y >= below.size.y) continue;
+
+                Color32 color = getPixel(i - 1, child);
+                if (color.a == 0) continue;
+
+                sum[0] += color.r;
+                sum[1] += color.g;
+                sum[2] += color.b;
+                count++;
+            }
+        }
+
+        Color32& result = level.bitmap.getPixel(pos.x, pos.y);
+        if (count > 0) {
+            result = { static_cast<uint8_t>(sum[0] / count), static_cast<uint8_t>(sum[1] / count), static_cast<uint8_t>(sum[2] / count), 255 };
+        }
+
+        m_dirty[level.offset + (pos.x / TILE_CACHE_TILE_SIZE) + (pos.y / TILE_CACHE_TILE_SIZE) * level.tiles.x] = true;
+    }
+}
+
+glm::ivec4 TileCache::getTileRange(size_t level, glm::vec2 viewMin, glm::vec2 viewMax) {
+    auto& info = m_levels[level];
+    float scale = static_cast<float>(TILE_CACHE_TILE_SIZE << level);
+
+    glm::ivec2 first = glm::ivec2(glm::floor(viewMin / scale));
+    glm::ivec2 last = glm::ivec2(glm::floor(viewMax / scale));
+    first = glm::clamp(first, glm::ivec2(0), info.tiles - 1);
+    last = glm::clamp(last, glm::ivec2(0), info.tiles - 1);
+
+    return { first, last };
+}
+
+void TileCache::requestLevel(size_t level, glm::vec2 viewMin, glm::vec2 viewMax) {
+    auto& info = m_levels[level];
+    glm::ivec4 range = getTileRange(level, viewMin, viewMax);
+
+    for (int32_t y = range.y; y <= range.w; y++) {
+        for (int32_t x = range.x; x <= range.z; x++) {
+            m_request.push_back(info.offset + x + y * info.tiles.x);
+        }
+    }
+}
+
+size_t TileCache::getLevel(uint32_t entry) {
+    size_t level = 0;
+    while (level + 1 < m_levels.size() && m_levels[level + 1].offset <= entry) level++;
+    return level;
+}
+
+int32_t TileCache::findSlot() {
+    int32_t result = -1;
+    uint64_t oldest = m_frame;
+
+    //an empty slot, otherwise the least recently used one that this frame does not need
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        auto& slot = m_slots[i];
+        if (slot.entry < 0) return static_cast<int32_t>(i);
+
+        if (slot.lastUsed < oldest) {
+            oldest = slot.lastUsed;
+            result = static_cast<int32_t>(i);
+        }
+    }
+
+    return result;
+}
+
+void TileCache::update(glm::vec2 viewMin, glm::vec2 viewMax, float zoom) {
+    m_frame++;
+    m_request.clear();
+
+    size_t topLevel = m_levels.size() - 1;
+    size_t level = static_cast<size_t>(glm::clamp(std::floor(std::log2(1.0f / zoom)), 0.0f, static_cast<float>(topLevel)));
+
+    //a coarser level is used when the view would need more tiles than half the atlas
+    while (level < topLevel) {
+        glm::ivec4 range = getTileRange(level, viewMin, viewMax);
+        size_t count = static_cast<size_t>(range.z - range.x + 1) * (range.w - range.y + 1);
+        if (count * 2 <= m_slots.size()) break;
+        level++;
+    }
+
+    //the top level is always kept, so there is something to show while finer tiles stream in
+    requestLevel(topLevel, viewMin, viewMax);
+    if (level < topLevel) {
+        requestLevel(level, viewMin, viewMax);
+    }
+
+    for (uint32_t entry : m_request) {
+        if (m_entries[entry] != 0) {
+            m_slots[m_entries[entry] - 1].lastUsed = m_frame;
+        }
+    }
+
+    size_t uploads = 0;
+    m_pending = false;
+
+    for (uint32_t entry : m_request) {
+        bool resident = m_entries[entry] != 0;
+        if (resident && !m_dirty[entry]) continue;
+
+        if (uploads == TILE_UPLOADS_PER_FRAME) {
+            m_pending = true;
+            break;
+        }
+
+        int32_t slot;
+        if (resident) {
+            slot = static_cast<int32_t>(m_entries[entry] - 1);
+        } else {
+            slot = findSlot();
+            if (slot < 0) break;
+
+            auto& evicted = m_slots[slot];
+            if (evicted.entry >= 0) {
+                m_entries[evicted.entry] = 0;
+                m_stats.evictions++;
+                m_stats.resident--;
+            }
+
+            evicted.entry = static_cast<int32_t>(entry);
+            evicted.lastUsed = m_frame;
+            m_entries[entry] = static_cast<uint32_t>(slot + 1);
+            m_stats.resident++;
+            m_tableDirty = true;
+        }
+
+        uploadTile(entry, slot);
+        uploads++;
+    }
+
+    if (m_tableDirty) {
+        uploadPageTable();
+    }
+}
+
+void TileCache::uploadTile(uint32_t entry, int32_t slot) {
+    size_t level = getLevel(entry);
+    auto& info = m_levels[level];
+    uint32_t index = entry - info.offset;
+
+    glm::ivec2 tile = glm::ivec2(index % info.tiles.x, index / info.tiles.x) * TILE_CACHE_TILE_SIZE;
+    glm::ivec2 extent = glm::min(glm::ivec2(TILE_CACHE_TILE_SIZE), info.size - tile);
+
+    for (int32_t y = 0; y < extent.y; y++) {
+        for (int32_t x = 0; x < extent.x; x++) {
+            m_tileData[x + y * extent.x] = getPixel(level, tile + glm::ivec2(x, y));
+        }
+    }
+
+    vk::Extent3D imageExtent = {};
+    imageExtent.width = static_cast<uint32_t>(extent.x);
+    imageExtent.height = static_cast<uint32_t>(extent.y);
+    imageExtent.depth = 1;
+
+    vk::Offset3D imageOffset = {};
+    imageOffset.x = (slot % TILE_CACHE_SLOTS) * TILE_CACHE_TILE_SIZE;
+    imageOffset.y = (slot / TILE_CACHE_SLOTS) * TILE_CACHE_TILE_SIZE;
+
+    m_staging->transfer(m_tileData.data(), extent.x * extent.y * sizeof(Color32), *m_atlas, vk::ImageLayout::TransferDstOptimal, imageExtent, imageOffset);
+
+    m_dirty[entry] = false;
+    m_stats.uploads++;
+}
+
+void TileCache::uploadPageTable() {
+    PageTableHeader header = {};
+    header.imageSize = glm::uvec2(m_size);
+    header.levels = static_cast<uint32_t>(m_levels.size());
+    header.tileSize = TILE_CACHE_TILE_SIZE;
+    header.slotsPerRow = TILE_CACHE_SLOTS;
+
+    for (size_t i = 0; i < m_levels.size(); i++) {
+        header.levelInfo[i] = glm::uvec4(m_levels[i].tiles.x, m_levels[i].tiles.y, m_levels[i].offset, 0);
+    }
+
+    memcpy(m_tableData.data(), &header, sizeof(PageTableHeader));
+    memcpy(m_tableData.data() + sizeof(PageTableHeader), m_entries.data(), m_entries.size() * sizeof(uint32_t));
+
+    m_staging->transfer(m_tableData.data(), m_tableData.size(), *m_pageTableBuffer);
+    m_tableDirty = false;
+}
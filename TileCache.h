@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include "Core.h"
+#include "Allocator.h"
+#include "Staging.h"
+#include "Bitmap.h"
+
+#define TILE_CACHE_TILE_SIZE 128
+//the atlas holds TILE_CACHE_SLOTS x TILE_CACHE_SLOTS tiles, whatever the image size
+#define TILE_CACHE_SLOTS 32
+#define TILE_CACHE_MAX_LEVELS 16
+
+struct TileCacheStats {
+    size_t resident;
+    size_t uploads;
+    size_t evictions;
+};
+
+//keeps the visible tiles of a large image, and of its mip pyramid, resident in a fixed size atlas
+class TileCache {
+    struct Level {
+        glm::ivec2 size;
+        glm::ivec2 tiles;
+        uint32_t offset;
+        Bitmap bitmap;
+    };
+
+    struct Slot {
+        int32_t entry;
+        uint64_t lastUsed;
+    };
+
+public:
+    TileCache(Core& core, Allocator& allocator, Staging& staging, Bitmap& bitmap);
+    TileCache(const TileCache& other) = delete;
+    TileCache& operator = (const TileCache& other) = delete;
+    ~TileCache();
+
+    void initialize(vk::CommandBuffer& commandBuffer);
+    void setPixel(glm::ivec2 pos);
+    void update(glm::vec2 viewMin, glm::vec2 viewMax, float zoom);
+
+    vk::Image& atlas() { return *m_atlas; }
+    vk::Buffer& pageTable() { return *m_pageTableBuffer; }
+    const TileCacheStats& stats() const { return m_stats; }
+    bool hasPending() const { return m_pending; }
+
+private:
+    Core* m_core;
+    Allocator* m_allocator;
+    Staging* m_staging;
+    Bitmap* m_bitmap;
+    glm::ivec2 m_size;
+    std::vector<Level> m_levels;
+    std::vector<uint32_t> m_entries;
+    std::vector<bool> m_dirty;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_request;
+    std::vector<Color32> m_tileData;
+    std::vector<char> m_tableData;
+    std::unique_ptr<vk::Image> m_atlas;
+    Allocation m_atlasAlloc;
+    std::unique_ptr<vk::Buffer> m_pageTableBuffer;
+    Allocation m_pageTableAlloc;
+    uint64_t m_frame = 0;
+    bool m_tableDirty = true;
+    bool m_pending = false;
+    TileCacheStats m_stats = {};
+
+    void createLevels();
+    void createAtlas();
+    void createPageTable();
+    Color32 getPixel(size_t level, glm::ivec2 pos);
+    glm::ivec4 getTileRange(size_t level, glm::vec2 viewMin, glm::vec2 viewMax);
+    void requestLevel(size_t level, glm::vec2 viewMin, glm::vec2 viewMax);
+    int32_t findSlot();
+    void uploadTile(uint32_t entry, int32_t slot);
+    void uploadPageTable();
+    size_t getLevel(uint32_t entry);
+};
@@ -0,0 +1,39 @@
+#include "TimelineSemaphore.h"
+
+TimelineSemaphore::TimelineSemaphore(vk::Device& device, uint64_t initialValue) {
+    m_device = device.handle();
+
+    VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    info.pNext = &typeInfo;
+
+    VKW_CHECK(vkCreateSemaphore(m_device, &info, nullptr, &m_semaphore));
+
+    m_waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(m_device, "vkWaitSemaphoresKHR"));
+    m_getCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(m_device, "vkGetSemaphoreCounterValueKHR"));
+}
+
+TimelineSemaphore::~TimelineSemaphore() {
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+}
+
+void TimelineSemaphore::wait(uint64_t value) {
+    VkSemaphoreWaitInfoKHR info = {};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    info.semaphoreCount = 1;
+    info.pSemaphores = &m_semaphore;
+    info.pValues = &value;
+
+    VKW_CHECK(m_waitSemaphores(m_device, &info, ~0ull));
+}
+
+uint64_t TimelineSemaphore::value() {
+    uint64_t value;
+    VKW_CHECK(m_getCounterValue(m_device, m_semaphore, &value));
+    return value;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <VulkanWrapper/VulkanWrapper.h>
+
+//VK_KHR_timeline_semaphore object, created directly since it needs a semaphore type in the create info
+class TimelineSemaphore {
+public:
+    TimelineSemaphore(vk::Device& device, uint64_t initialValue);
+    TimelineSemaphore(const TimelineSemaphore& other) = delete;
+    TimelineSemaphore& operator = (const TimelineSemaphore& other) = delete;
+    ~TimelineSemaphore();
+
+    VkSemaphore handle() const { return m_semaphore; }
+    void wait(uint64_t value);
+    uint64_t value();
+
+private:
+    VkDevice m_device;
+    VkSemaphore m_semaphore;
+    PFN_vkWaitSemaphoresKHR m_waitSemaphores;
+    PFN_vkGetSemaphoreCounterValueKHR m_getCounterValue;
+};
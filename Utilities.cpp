@@ -1,4 +1,5 @@
 #include "Utilities.h"
+#include "Shaders.h"
 #include <fstream>
 #include <stdexcept>
 
@@ -15,8 +16,16 @@ std::vector<char> loadFile(const std::string& path) {
     return result;
 }
 
+void saveFile(const std::string& path, const std::vector<char>& data) {
+    std::ofstream file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Could not open file");
+
+    file.write(data.data(), data.size());
+    if (!file) throw std::runtime_error("Could not write file");
+}
+
 vk::ShaderModule loadShader(vk::Device& device, const std::string& path) {
-    std::vector<char> data = loadFile(path);
+    std::vector<char> data = getShaderCode(path);
 
     vk::ShaderModuleCreateInfo info = {};
     info.code = std::move(data);
@@ -35,4 +44,9 @@ size_t align(size_t ptr, size_t align) {
 
 int32_t length2(glm::ivec3 v) {
     return v.x * v.x + v.y * v.y + v.z * v.z;
-}
\ No newline at end of file
+}
+
+std::mutex& outputMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
@@ -2,6 +2,9 @@
 #include <vector>
 #include <VulkanWrapper/VulkanWrapper.h>
 #include <glm/glm.hpp>
+#include <unordered_set>
+#include <mutex>
+#include "MemoryTracker.h"
 
 namespace std {
     template<> struct hash<glm::ivec2> {
@@ -13,7 +16,13 @@ namespace std {
     };
 }
 
+using OpenSet = std::unordered_set<glm::ivec2, std::hash<glm::ivec2>, std::equal_to<glm::ivec2>, TrackingAllocator<glm::ivec2, MemoryCategory::OpenSet>>;
+using OpenList = std::vector<glm::ivec2, TrackingAllocator<glm::ivec2, MemoryCategory::OpenSet>>;
+
 std::vector<char> loadFile(const std::string& path);
+void saveFile(const std::string& path, const std::vector<char>& data);
 vk::ShaderModule loadShader(vk::Device& device, const std::string& path);
 size_t align(size_t ptr, size_t align);
-int32_t length2(glm::ivec3 v);
\ No newline at end of file
+int32_t length2(glm::ivec3 v);
+//jobs run generators side by side, so each summary is printed under this to keep their lines apart
+std::mutex& outputMutex();
\ No newline at end of file
@@ -4,19 +4,29 @@
 #include <iomanip>
 
 WaveGenerator::WaveGenerator(ColorSource& source, ColorQueue& colorQueue, Options& options) 
-    : m_bitmap(options.size.x, options.size.y) {
+    : m_bitmap(options.size.x, options.size.y),
+    m_colors(options.metric == Metric::Lab ? options.size.x : 0, options.metric == Metric::Lab ? options.size.y : 0),
+    m_metric(options.metric) {
     m_source = &source;
     m_queue = &colorQueue;
     m_running = std::make_unique<std::atomic_bool>();
+    m_finished = std::make_unique<std::atomic_bool>(false);
+
+    if (options.sampleSize > 0) {
+        m_sampler = std::make_unique<FrontierSampler>(options.sampleSize, options.seed);
+    }
 
     glm::ivec2 pos = { static_cast<int>(m_bitmap.width() / 2), static_cast<int>(m_bitmap.height() / 2) };
     if (m_source->hasNext()) {
-        m_bitmap.getPixel(pos.x, pos.y) = m_source->getNext();
+        Color32 color = m_source->getNext();
+        m_queue->enqueue(pos, color);
+        m_bitmap.getPixel(pos.x, pos.y) = m_metric.getKey(color);
+        setColor(pos, color);
         addNeighborsToOpenSet(pos);
     }
 }
 
-WaveGenerator::WaveGenerator(WaveGenerator&& other) : m_bitmap(std::move(other.m_bitmap)) {
+WaveGenerator::WaveGenerator(WaveGenerator&& other) : m_bitmap(std::move(other.m_bitmap)), m_colors(std::move(other.m_colors)), m_metric(other.m_metric) {
     *this = std::move(other);
 }
 
@@ -39,12 +49,17 @@ void WaveGenerator::mainLoop() {
         if (!m_source->hasNext()) break;
         if (m_openSet.size() == 0) break;
 
-        m_openList.clear();
-        for (auto pos : m_openSet) {
-            m_openList.push_back(pos);
+        if (m_sampler != nullptr) {
+            m_sampler->sample(m_openList);
+        } else {
+            m_openList.clear();
+            for (auto pos : m_openSet) {
+                m_openList.push_back(pos);
+            }
         }
 
         m_color = m_source->getNext();
+        m_key = m_metric.getKey(m_color);
         
         size_t result = score();
         readResult(result);
@@ -57,12 +72,18 @@ void WaveGenerator::mainLoop() {
     auto elapsed = std::chrono::duration<double>(end - start).count();
     size_t totalPixels = m_queue->totalCount();
     size_t rate = (size_t)(totalPixels / elapsed);
+    //measured on the display colors, so runs with different metrics compare on the same scale
+    double quality = ColorMetric::neighborDistance(m_colors.width() > 0 ? m_colors : m_bitmap);
+
+    std::lock_guard<std::mutex> lock(outputMutex());
     if (elapsed < 10.0) {
         std::cout << std::setprecision(1) << std::fixed;
     } else {
         std::cout << std::setprecision(0) << std::fixed;
     }
     std::cout << totalPixels << " in " << elapsed << "s (" << rate << " pps)\n";
+    std::cout << std::setprecision(2) << "Quality: " << quality << " average neighbor distance\n";
+    *m_finished = true;
 }
 
 size_t WaveGenerator::score() {
@@ -81,7 +102,7 @@ size_t WaveGenerator::score() {
             pos + glm::ivec2{  1,  1 },
         };
 
-        glm::ivec3 testColor = { m_color.r, m_color.g, m_color.b };
+        glm::ivec3 testColor = { m_key.r, m_key.g, m_key.b };
         glm::int32_t diffs[8];
 
         for (size_t j = 0; j < 8; j++) {
@@ -108,19 +129,37 @@ size_t WaveGenerator::score() {
         }
     }
 
+    m_score = bestScore;
     return result;
 }
 
+void WaveGenerator::setColor(glm::ivec2 pos, Color32 color) {
+    if (m_colors.width() > 0) {
+        m_colors.getPixel(pos.x, pos.y) = color;
+    }
+}
+
 void WaveGenerator::readResult(size_t result) {
     glm::ivec2 pos = m_openList[result];
     m_queue->enqueue(pos, m_color);
-    m_bitmap.getPixel(pos.x, pos.y) = m_color;
+    //the bitmap only feeds scoring, so it holds keys rather than display colors
+    m_bitmap.getPixel(pos.x, pos.y) = m_key;
+    setColor(pos, m_color);
     addNeighborsToOpenSet(pos);
     m_openSet.erase(pos);
+
+    if (m_sampler != nullptr) {
+        m_sampler->remove(pos);
+        m_sampler->place(pos, m_score);
+    }
 }
 
 void WaveGenerator::addToOpenSet(glm::ivec2 pos) {
     m_openSet.insert(pos);
+
+    if (m_sampler != nullptr) {
+        m_sampler->add(pos);
+    }
 }
 
 void WaveGenerator::addNeighborsToOpenSet(glm::ivec2 pos) {
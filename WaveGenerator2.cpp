@@ -5,6 +5,7 @@ WaveGenerator2::WaveGenerator2(ColorSource& source, Bitmap& bitmap, ColorQueue&
     m_bitmap = &bitmap;
     m_queue = &colorQueue;
     m_running = std::make_unique<std::atomic_bool>();
+    m_finished = std::make_unique<std::atomic_bool>(false);
 
     glm::ivec2 pos = { static_cast<int>(m_bitmap->width() / 2), static_cast<int>(m_bitmap->height() / 2) };
     if (m_source->hasNext()) {
@@ -45,6 +46,8 @@ void WaveGenerator2::mainLoop() {
         size_t result = score();
         readResult(result);
     }
+
+    *m_finished = true;
 }
 
 size_t WaveGenerator2::score() {
@@ -21,6 +21,7 @@ public:
 
     void run();
     void stop();
+    bool finished() { return *m_finished; }
 
 private:
     ColorSource* m_source;
@@ -29,8 +30,9 @@ private:
     Bitmap m_scratch;
     std::thread m_mainThread;
     std::unique_ptr<std::atomic_bool> m_running;
-    std::unordered_set<glm::ivec2> m_openSet;
-    std::vector<glm::ivec2> m_openList;
+    std::unique_ptr<std::atomic_bool> m_finished;
+    OpenSet m_openSet;
+    OpenList m_openList;
     Color32 m_color;
 
     void mainLoop();
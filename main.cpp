@@ -3,6 +3,8 @@
 #include <chrono>
 #include <sstream>
 #include <iomanip>
+#include <thread>
+#include <algorithm>
 #include "Core.h"
 #include "Allocator.h"
 #include "Renderer.h"
@@ -14,22 +16,166 @@
 #include "CoralGenerator.h"
 #include "ColorQueue.h"
 #include "Options.h"
+#include "Shaders.h"
+#include "JobRunner.h"
+#include "MemoryTracker.h"
+#include "FrameRecorder.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <stdio.h>
+#endif
 
 #define AMD_VENDOR_ID 0x1002
+//seconds the window waits for events while nothing changes, so the title still updates
+#define IDLE_TIMEOUT 0.25
 
-int main(int argc, char** argv) {
+void runWindow(GLFWwindow* window, Core& core, Renderer& renderer, ColorQueue& colorQueue, ComputeGenerator* shaderGenerator, uint32_t maxFps) {
     auto last = std::chrono::system_clock::now();
+    size_t frames = 0;
+    size_t lastCount = 0;
+
+    //0 leaves the frame rate to vsync
+    auto frameInterval = std::chrono::duration<double>(maxFps > 0 ? 1.0 / maxFps : 0.0);
+    auto nextFrame = std::chrono::steady_clock::now();
+    bool firstFrame = true;
+
+    auto isDirty = [&]() {
+        return firstFrame || core.needsRedraw() || !colorQueue.empty() || renderer.hasPendingUploads();
+    };
+
+    glfwShowWindow(window);
+    while (!glfwWindowShouldClose(window)) {
+        bool dirty = isDirty();
+        auto frameNow = std::chrono::steady_clock::now();
+
+        if (!dirty) {
+            //nothing to show, sleep until an event or the next title update
+            glfwWaitEventsTimeout(IDLE_TIMEOUT);
+        } else if (frameNow < nextFrame) {
+            glfwWaitEventsTimeout(std::chrono::duration<double>(nextFrame - frameNow).count());
+        } else {
+            glfwPollEvents();
+        }
+
+        dirty = isDirty();
+        frameNow = std::chrono::steady_clock::now();
+
+        if (dirty && frameNow >= nextFrame) {
+            core.acquire();
+            renderer.record(core.getCommandBuffer());
+            core.present();
+
+            frames++;
+            firstFrame = false;
+            nextFrame = std::max(nextFrame + std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameInterval), frameNow);
+        }
+
+        auto now = std::chrono::system_clock::now();
+        std::chrono::duration<float> elapsed = now - last;
+        size_t totalCount = colorQueue.totalCount();
+        size_t pixelsAdded = totalCount - lastCount;
+
+        if (elapsed.count() > 0.25f) {
+            std::stringstream builder;
+            builder << std::setprecision(0) << std::fixed;
+            builder << "Colors - " << static_cast<double>(frames) / elapsed.count() << " fps " << static_cast<double>(pixelsAdded) / elapsed.count() << " pps";
+
+            builder << std::setprecision(2);
+            if (renderer.profiler().enabled()) {
+                builder << " - render " << renderer.profiler().averageTotal() << " ms";
+            }
+            if (shaderGenerator != nullptr && shaderGenerator->profiler().enabled()) {
+                builder << " - compute " << shaderGenerator->profiler().averageTotal() << " ms";
+            }
+
+            builder << " - " << MemoryTracker::currentRSS() / (1024 * 1024) << " MB";
+
+            glfwSetWindowTitle(window, builder.str().c_str());
+            frames = 0;
+            last = now;
+            lastCount = totalCount;
+        }
+    }
+}
+
+void reportMemory(const Options& options, Allocator& allocator) {
+    auto heapStats = allocator.stats();
+    for (size_t i = 0; i < heapStats.size(); i++) {
+        auto& heap = heapStats[i];
+        if (heap.peak == 0) continue;
+
+        std::cout << "Heap " << i << ": " << heap.live / 1024 << " KB live, " << heap.peak / 1024 << " KB peak, "
+            << heap.wasted / 1024 << " KB wasted, " << heap.budget / (1024 * 1024) << " MB budget\n";
+    }
+
+    MemoryTracker::printSummary();
+
+    if (!options.memoryReport.empty()) {
+        MemoryTracker::writeReport(options.memoryReport, heapStats);
+    }
+}
+
+int main(int argc, char** argv) {
     Options options = parseArguments(argc, argv);
 
     if (!options.valid) {
         return EXIT_FAILURE;
     }
 
-    glfwInit();
+    //a video streamed to stdout must not be mixed with messages, so everything printed goes to stderr from here on
+    std::streambuf* videoOutput = nullptr;
+
+    if (options.frames == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        videoOutput = std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    setShaderDirectory(options.shaderDirectory);
+
+    //jobs write their images to files, so no window is needed
+    if (!options.jobs.empty()) {
+        options.headless = true;
+    } else if (!options.output.empty()) {
+        std::cout << "Error: Output files are only written for jobs, use '--jobs'\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!options.jobs.empty() && !options.frames.empty()) {
+        std::cout << "Error: Frames are not recorded for jobs\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!options.frames.empty() && FrameRecorder::ringSize(options.size.x, options.size.y) == 0) {
+        std::cout << "Error: Frames of " << options.size.x << "x" << options.size.y << " do not fit in the "
+            << FrameRecorder::memoryBudget() / (1024 * 1024) << " MB frame budget, use a smaller size\n";
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<FrameRecorder> frameRecorder;
+
+    //opened before any window or generator exists, so a bad path fails straight away
+    if (!options.frames.empty()) {
+        frameRecorder = std::make_unique<FrameRecorder>(options, videoOutput);
+
+        if (!frameRecorder->valid()) {
+            std::cout << "Error: " << frameRecorder->error() << "\n";
+            return EXIT_FAILURE;
+        }
+    }
 
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_VISIBLE, 0);
-    GLFWwindow* window = glfwCreateWindow(800, 600, "Colors", nullptr, nullptr);
+    GLFWwindow* window = nullptr;
+
+    if (!options.headless) {
+        glfwInit();
+
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_VISIBLE, 0);
+        window = glfwCreateWindow(800, 600, "Colors", nullptr, nullptr);
+    }
 
     Core core = Core(window);
 
@@ -38,11 +184,39 @@ int main(int argc, char** argv) {
         options.workGroupSize = 64;
     }
 
+    if (!options.jobs.empty()) {
+        Allocator allocator = Allocator(core);
+        JobRunner runner(core, allocator, std::vector<std::string>(argv + 1, argv + argc), options.workGroupSize);
+
+        if (!runner.load(options.jobs)) {
+            return EXIT_FAILURE;
+        }
+
+        runner.run();
+        core.device().waitIdle();
+        core.savePipelineCache();
+        reportMemory(options, allocator);
+        return 0;
+    }
+
+    uint32_t maxImageDimension = core.device().physicalDevice().properties().limits.maxImageDimension2D;
+    bool oversized = static_cast<uint32_t>(std::max(options.size.x, options.size.y)) > maxImageDimension;
+
+    if (oversized && options.generator == GeneratorType::Shader) {
+        std::cout << "Error: The shader generators are limited to " << maxImageDimension << "x" << maxImageDimension << " on this device, use 'cpu-wave' or 'cpu-coral'\n";
+        return EXIT_FAILURE;
+    }
+
     Allocator allocator = Allocator(core);
     ColorQueue colorQueue;
-    Renderer renderer = Renderer(core, allocator, options.size, colorQueue);
     std::unique_ptr<ColorSource> source;
 
+    //before any generator exists, since they place their first pixel when constructed
+    if (frameRecorder != nullptr) {
+        FrameRecorder* recorder = frameRecorder.get();
+        colorQueue.setListener([recorder](glm::ivec2 pos, Color32 color) { recorder->place(pos, color); });
+    }
+
     if (options.source == Source::Shuffle) {
         source = std::make_unique<ShuffleSource>(options);
     } else if (options.source == Source::Hue) {
@@ -50,49 +224,75 @@ int main(int argc, char** argv) {
     }
 
     std::unique_ptr<Generator> generator;
+    ComputeGenerator* shaderGenerator = nullptr;
+    vk::Image* sharedTexture = nullptr;
 
     if (options.generator == GeneratorType::Shader) {
-        generator = std::make_unique<ComputeGenerator>(core, allocator, *source, colorQueue, options);
+        auto computeGenerator = std::make_unique<ComputeGenerator>(core, allocator, *source, colorQueue, options);
+        //render straight from the generator's image instead of uploading every pixel
+        sharedTexture = &computeGenerator->texture();
+        shaderGenerator = computeGenerator.get();
+        generator = std::move(computeGenerator);
     } else if (options.generator == GeneratorType::CPUCoral) {
         generator = std::make_unique<CoralGenerator>(*source, colorQueue, options);
     } else if (options.generator == GeneratorType::CPUWave) {
         generator = std::make_unique<WaveGenerator>(*source, colorQueue, options);
     }
 
-    generator->run();
-
-    size_t frames = 0;
-    size_t lastCount = 0;
+    std::unique_ptr<Renderer> renderer;
 
-    glfwShowWindow(window);
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+    if (!options.headless) {
+        //the tiled renderer keeps its own copy of the image, so it does not use the generator's texture
+        bool tiled = options.tiled || oversized;
+        renderer = std::make_unique<Renderer>(core, allocator, options.size, colorQueue, tiled ? nullptr : sharedTexture, tiled);
+    }
 
-        core.acquire();
-        renderer.record(core.getCommandBuffer());
-        core.present();
+    //the generator wakes the loop when it places pixels after an idle period, so this is set
+    //before its threads start and cleared once they have stopped
+    if (!options.headless) {
+        colorQueue.setNotify([]() { glfwPostEmptyEvent(); });
+    }
 
-        frames++;
-        auto now = std::chrono::system_clock::now();
-        std::chrono::duration<float> elapsed = now - last;
-        size_t totalCount = colorQueue.totalCount();
-        size_t pixelsAdded = totalCount - lastCount;
+    generator->run();
 
-        if (elapsed.count() > 0.25f) {
-            std::stringstream builder;
-            builder << std::setprecision(0) << std::fixed;
-            builder << "Colors - " << static_cast<double>(frames) / elapsed.count() << " fps " << static_cast<double>(pixelsAdded) / elapsed.count() << " pps";
-            glfwSetWindowTitle(window, builder.str().c_str());
-            frames = 0;
-            last = now;
-            lastCount = totalCount;
+    if (options.headless) {
+        //nothing draws the placed pixels, the queue only has to be emptied so the count stays current
+        while (!generator->finished()) {
+            colorQueue.swap();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
+    } else {
+        runWindow(window, core, *renderer, colorQueue, shaderGenerator, options.maxFps);
     }
 
     generator->stop();
+    colorQueue.setNotify(nullptr);
     core.device().waitIdle();
+    core.savePipelineCache();
+
+    if (frameRecorder != nullptr) {
+        frameRecorder->finish();
+    }
+
+    if (renderer != nullptr) {
+        auto& stagingStats = renderer->stagingStats();
+        std::cout << "Staging: " << stagingStats.highWater << " / " << stagingStats.capacity << " bytes high water, "
+            << stagingStats.deferred << " bytes deferred in " << stagingStats.splits << " splits\n";
+    }
+
+    reportMemory(options, allocator);
+
+    if (renderer != nullptr) {
+        renderer->profiler().printSummary("Render");
+    }
+    if (shaderGenerator != nullptr) {
+        shaderGenerator->profiler().printSummary("Compute");
+    }
+
+    if (window != nullptr) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+#define MAX_LEVELS 16
+
+layout(location = 0) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D atlas;
+
+layout(binding = 1) readonly buffer PageTable {
+    uvec2 imageSize;
+    uint levels;
+    uint tileSize;
+    uint slotsPerRow;
+    uint padding[3];
+    uvec4 levelInfo[MAX_LEVELS];
+    uint entries[];
+} pageTable;
+
+void main() {
+    vec2 pixel = fragUV * vec2(pageTable.imageSize);
+
+    //one level per halving, picked from how many image pixels this fragment covers
+    float footprint = max(length(dFdx(pixel)), length(dFdy(pixel)));
+    int level = clamp(int(floor(log2(max(footprint, 1.0)))), 0, int(pageTable.levels) - 1);
+
+    ivec2 pos = clamp(ivec2(pixel), ivec2(0), ivec2(pageTable.imageSize) - 1);
+
+    //tiles that are still streaming in are drawn from the nearest coarser level that is resident
+    for (int i = level; i < int(pageTable.levels); i++) {
+        ivec2 levelPos = pos >> i;
+        ivec2 tile = levelPos / int(pageTable.tileSize);
+        uvec4 info = pageTable.levelInfo[i];
+        uint entry = pageTable.entries[info.z + uint(tile.x) + uint(tile.y) * info.x];
+
+        if (entry != 0) {
+            uint slot = entry - 1;
+            ivec2 slotPos = ivec2(slot % pageTable.slotsPerRow, slot / pageTable.slotsPerRow) * int(pageTable.tileSize);
+            outColor = texelFetch(atlas, slotPos + levelPos % int(pageTable.tileSize), 0);
+            return;
+        }
+    }
+
+    outColor = vec4(0.0);
+}